@@ -0,0 +1,33 @@
+# submits a planning experiment to a running server (./build/bin/main Serve) and waits for it to finish
+# usage: python3 scripts/submit.py path/to/socket path/to/config path/to/results
+#        python3 scripts/submit.py path/to/socket stop
+
+import json
+import socket
+import sys
+
+
+def submit(path_to_socket, request):
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as client:
+        client.connect(path_to_socket)
+        client.sendall((json.dumps(request) + "\n").encode())
+        answer = b""
+        while not answer.endswith(b"\n"):
+            chunk = client.recv(4096)
+            if not chunk:
+                break
+            answer += chunk
+    return json.loads(answer)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) == 3 and sys.argv[2] == "stop":
+        request = {"command": "stop"}
+    elif len(sys.argv) == 4:
+        request = {"config": sys.argv[2], "results": sys.argv[3]}
+    else:
+        print("usage: python3 scripts/submit.py path/to/socket (path/to/config path/to/results | stop)")
+        sys.exit(1)
+    answer = submit(sys.argv[1], request)
+    print(answer)
+    sys.exit(0 if answer.get("status") == "ok" else 1)
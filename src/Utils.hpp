@@ -7,6 +7,19 @@
 #include "yaml-cpp/yaml.h"
 #include <string.h>
 #include <type_traits>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ctime>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+#include <filesystem>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <random>
+#include <experimental/random>
 
 namespace StringUtils {
 
@@ -101,6 +114,165 @@ namespace YAMLUtils {
     
 }
 
+// the mean, variance, minimum and maximum of a stream of values, updated with Welford's algorithm
+struct RunningStatistics {
+  long count = 0;
+  double mean = 0.0;
+  double sumOfSquaredDeviations = 0.0;
+  double minimum = std::numeric_limits<double>::infinity();
+  double maximum = -std::numeric_limits<double>::infinity();
+
+  void add(double value) {
+    count += 1;
+    double deviation = value - mean;
+    mean += deviation / count;
+    sumOfSquaredDeviations += deviation * (value - mean);
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+  }
+
+  // the unbiased sample variance, 0 for fewer than two values
+  double variance() const {
+    return count > 1 ? sumOfSquaredDeviations / (count - 1) : 0.0;
+  }
+
+  // the half width of an asymptotic confidence sequence for the mean (Waudby-Smith et al., 2021), which holds at all counts at once,
+  // so it stays valid when it is checked after every value to decide when to stop. the width is tightest at optimizedCount
+  double confidenceSequenceHalfWidth(double confidence, long optimizedCount) const {
+    double alpha = 1.0 - confidence;
+    double rhoSquared = (-2.0 * std::log(alpha) + std::log(-2.0 * std::log(alpha) + 1.0)) / std::max(optimizedCount, 1L);
+    double scaledCount = count * rhoSquared + 1.0;
+    return std::sqrt(variance() * 2.0 * scaledCount / (count * (double)count * rhoSquared) * std::log(std::sqrt(scaledCount) / alpha));
+  }
+};
+
+namespace TimeUtils {
+  // the processor time of the calling thread in seconds
+  // std::clock counts the processor time of all threads, which overstates the time of a thread when episodes run in parallel
+  double threadProcessorTime() {
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec + 1e-9 * time.tv_nsec;
+  }
+}
+
+namespace RandomUtils {
+  // the generator lent to the calling thread, none if the thread draws from its own generator of std::experimental
+  std::default_random_engine *&lentGenerator() {
+    thread_local std::default_random_engine *generatorPtr = nullptr;
+    return generatorPtr;
+  }
+
+  // the random integers of agents and simulators that do not get a generator of their own
+  int randint(int a, int b) {
+    std::default_random_engine *generatorPtr = lentGenerator();
+    if (generatorPtr == nullptr) {
+      return std::experimental::randint(a, b);
+    }
+    return std::uniform_int_distribution<int>(a, b)(*generatorPtr);
+  }
+
+  // lends a generator to the calling thread while it is in scope, so that a caller seeds its draws without reseeding the thread
+  class GeneratorLoan {
+    public:
+      GeneratorLoan(std::default_random_engine &generator): _previousGeneratorPtr(lentGenerator()) {
+        lentGenerator() = &generator;
+      }
+      ~GeneratorLoan() {
+        lentGenerator() = _previousGeneratorPtr;
+      }
+      GeneratorLoan(const GeneratorLoan&) = delete;
+      GeneratorLoan &operator=(const GeneratorLoan&) = delete;
+    private:
+      std::default_random_engine *_previousGeneratorPtr;
+  };
+}
+
+namespace FileUtils {
+  // the path of a file with the time it was last modified, to tell versions of a file apart in the keys of loaded resources
+  std::string versionedPath(const std::string &path) {
+    std::error_code error;
+    auto modificationTime = std::filesystem::last_write_time(path, error);
+    if (error) {
+      return path;
+    }
+    return path + "@" + std::to_string(modificationTime.time_since_epoch().count());
+  }
+}
+
+namespace HashUtils {
+  // a hash of the bytes of the elements of a vector
+  template <class T> size_t hashBytes(const std::vector<T> &values) {
+    return std::hash<std::string_view>()(std::string_view((const char*)values.data(), values.size() * sizeof(T)));
+  }
+  template <class T> bool sameBytes(const std::vector<T> &a, const std::vector<T> &b) {
+    return a.size() == b.size() && std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+  }
+  size_t combine(size_t seed, size_t hash) {
+    return seed ^ (hash + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+  }
+}
+
+// a process-wide registry of immutable resources (e.g. trained models) keyed by a string
+// the resource is loaded by the first caller and shared by all later callers while it is alive
+// resources that are compared by value (e.g. the tables of a network) are keyed by a hash of the value and matched with equals
+template <class Resource> class SharedResourceRegistry {
+  public:
+    static std::shared_ptr<const Resource> get(const std::string &key, const std::function<Resource*()> &load) {
+      std::lock_guard<std::mutex> lock(getMutex());
+      std::weak_ptr<const Resource> &entry = getEntries()[key];
+      std::shared_ptr<const Resource> resourcePtr = entry.lock();
+      if (resourcePtr == nullptr) {
+        resourcePtr = std::shared_ptr<const Resource>(load());
+        entry = resourcePtr;
+        sweep(getEntries());
+      }
+      return resourcePtr;
+    }
+
+    static std::shared_ptr<const Resource> get(size_t hash, const std::function<bool(const Resource&)> &equals, const std::function<Resource*()> &load) {
+      std::lock_guard<std::mutex> lock(getMutex());
+      auto range = getHashedEntries().equal_range(hash);
+      for (auto it=range.first; it!=range.second; it++) {
+        std::shared_ptr<const Resource> resourcePtr = it->second.lock();
+        if (resourcePtr != nullptr && equals(*resourcePtr) == true) {
+          return resourcePtr;
+        }
+      }
+      std::shared_ptr<const Resource> resourcePtr(load());
+      getHashedEntries().emplace(hash, resourcePtr);
+      sweep(getHashedEntries());
+      return resourcePtr;
+    }
+  private:
+    static std::mutex &getMutex() {
+      static std::mutex mutex;
+      return mutex;
+    }
+    static std::map<std::string, std::weak_ptr<const Resource>> &getEntries() {
+      static std::map<std::string, std::weak_ptr<const Resource>> entries;
+      return entries;
+    }
+    static std::unordered_multimap<size_t, std::weak_ptr<const Resource>> &getHashedEntries() {
+      static std::unordered_multimap<size_t, std::weak_ptr<const Resource>> entries;
+      return entries;
+    }
+
+    // the entries of released resources are erased once the entries have doubled since the last sweep,
+    // so a long running process keeps as many entries as resources alive, in constant amortized time per resource loaded
+    template <class Entries>
+    static void sweep(Entries &entries) {
+      static size_t sizeAfterSweep = 0;
+      if (entries.size() < 2 * sizeAfterSweep + 16) {
+        return;
+      }
+      for (auto it=entries.begin(); it!=entries.end();) {
+        it = it->second.expired() == true ? entries.erase(it) : std::next(it);
+      }
+      sizeAfterSweep = entries.size();
+    }
+};
+
 namespace FireFighterUtils {
   std::string environmentStateToString(std::vector<int> &environmentState) {
     std::string str = "";
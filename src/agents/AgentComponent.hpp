@@ -3,6 +3,7 @@
 #include <memory>
 #include "yaml-cpp/yaml.h"
 #include <ctime>
+#include <random>
 
 // an abstract class
 class AgentComponent {
@@ -14,8 +15,11 @@ class AgentComponent {
       
     }
     virtual void reset() = 0;
-    virtual void act(std::map<std::string, int> &action, std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentsYAMLNode) = 0;
+    // the IDs of the agents in the order of their slots in the metrics given to act
+    virtual std::vector<std::string> getAgentIDs() = 0;
+    virtual void act(std::map<std::string, int> &action, EpisodeMetrics &metrics, YAML::Node &agentsYAMLNode) = 0;
     virtual void observe(std::map<std::string, int> &observation) = 0;
+    virtual void seed(unsigned int seed) = 0;
 };
 
 // an agent component which consists of only atomic agents
@@ -40,12 +44,23 @@ class SimpleAgentComponent: public AgentComponent {
     }
 
     // the agent component picks a joint action according to the interal states of the atomic agents
-    void act(std::map<std::string, int> &action, std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentsYAMLNode) {
+    std::vector<std::string> getAgentIDs() {
+      std::vector<std::string> agentIDs;
       for (const auto &[key, val]: _atomicAgents) {
-        auto begin = clock();
-        action[key] = val->act(results, agentsYAMLNode);
-        float elapsed_secs = double(clock()-begin) / CLOCKS_PER_SEC;
-        results["time_per_action"][key].push_back(elapsed_secs);
+        agentIDs.push_back(key);
+      }
+      return agentIDs;
+    }
+
+    // the slot of an agent is its position in the map of atomic agents
+    void act(std::map<std::string, int> &action, EpisodeMetrics &metrics, YAML::Node &agentsYAMLNode) {
+      int slot = 0;
+      for (const auto &[key, val]: _atomicAgents) {
+        double begin = TimeUtils::threadProcessorTime();
+        action[key] = val->act(metrics.getAgentMetrics(slot), agentsYAMLNode);
+        float elapsed_secs = TimeUtils::threadProcessorTime() - begin;
+        metrics.push(TIME_PER_ACTION, slot, elapsed_secs);
+        slot += 1;
       }
     }
     
@@ -55,6 +70,18 @@ class SimpleAgentComponent: public AgentComponent {
         val->observe(observation[key]);
       }
     }
+
+    // every atomic agent gets its own seed, derived from the seed of the component and the position of the agent
+    void seed(unsigned int seed) {
+      int index = 0;
+      for (const auto &[key, val]: _atomicAgents) {
+        std::seed_seq sequence{seed, (unsigned int)index};
+        unsigned int agentSeed;
+        sequence.generate(&agentSeed, &agentSeed+1);
+        val->seed(agentSeed);
+        index += 1;
+      }
+    }
 private:
     std::map<std::string, std::unique_ptr<AtomicAgent>> _atomicAgents;
 };
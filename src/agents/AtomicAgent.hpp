@@ -6,8 +6,17 @@
 #include <experimental/random>
 #include <queue>
 #include "Utils.hpp"
+#include "agents/EpisodeMetrics.hpp"
 #include <math.h>
 #include <memory>
+#include <chrono>
+
+// the search tree below the current history of a planning agent, per action
+struct RootStatistics {
+  std::vector<int> visits;
+  std::vector<float> values;
+  int numberOfParticles = 0;
+};
 
 class AtomicAgent {
   public:
@@ -17,14 +26,24 @@ class AtomicAgent {
       _agentID = agentID;
       _parameters = parameters;
     }
+    virtual ~AtomicAgent() {}
     // clear and reset the AOH
     virtual void reset() {
       _AOH.clear();
       _AOH.resize(1 + 2 * _numberOfStepsToPlan);
       _AOH[0] = 1; // restart the AOH
     }
-    virtual int act(std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentsYAMLNode) = 0;
+    virtual int act(EpisodeMetrics::AgentMetrics metrics, YAML::Node &agentsYAMLNode) = 0;
     virtual void observe(int &observation) = 0;
+    // seed the random number generators the agent owns, agents that draw from RandomUtils::randint are seeded with the thread
+    virtual void seed(unsigned int seed) {}
+    // the budget of the following steps of a planning agent, a limit that is not positive is not applied
+    // a step also stops planning at the deadline on the wall clock, after at least one simulation
+    virtual void setPlanningBudget(int numberOfSimulationsPerStep, double numberOfSecondsPerStep, const std::chrono::steady_clock::time_point &deadline = std::chrono::steady_clock::time_point::max()) {}
+    // false if the agent does not plan
+    virtual bool getRootStatistics(RootStatistics &statistics) {
+      return false;
+    }
   protected:
     int _numberOfActions;
     int _numberOfStepsToPlan;
@@ -36,6 +55,7 @@ class AtomicAgent {
 class AtomicAgentSimulator {
   public:
     AtomicAgentSimulator() {}
+    virtual ~AtomicAgentSimulator() {}
     // the key function that reads in a history and gives an action and updates the history with the action taken
     virtual int step(const std::vector<int>::iterator &it) = 0;
     // this function should be same for every agent simulator and atomic agents that are not planning agents
@@ -43,6 +63,61 @@ class AtomicAgentSimulator {
       *(it+(*it)) = observation;
       *it += 1;
     }
+    // optional compact policy state: a fixed size summary of the history that the global simulator stores instead of the AOH
+    // -1 means that the policy needs the full AOH
+    virtual int getSizeOfCompactState() {
+      return -1;
+    }
+    // the iterator points to the first element of the compact state
+    virtual void resetCompactState(const std::vector<int>::iterator &it) {}
+    virtual int stepCompact(const std::vector<int>::iterator &it) {
+      LOG(FATAL) << "Compact policy state is not supported by this agent simulator.";
+      return -1;
+    }
+    virtual void observeCompact(const std::vector<int>::iterator &it, int &observation) {}
+
+    // agents whose policies have the same non-empty key act identically, so the global simulator evaluates them in one batch
+    virtual std::string getPolicyKey() {
+      return "";
+    }
+    // the compact states of a batch are stored as structure of arrays: element k of agent i is at states[k*numberOfAgents+i]
+    // actions are written into the dense environment state at the action indices of the agents
+    virtual void resetCompactStates(int *states, int numberOfAgents) {
+      int sizeOfCompactState = getSizeOfCompactState();
+      std::vector<int> compactState(sizeOfCompactState);
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        resetCompactState(compactState.begin());
+        scatterCompactState(compactState, states, numberOfAgents, i);
+      }
+    }
+    virtual void stepCompactBatch(int *states, int numberOfAgents, int *environmentState, const int *actionIndices) {
+      std::vector<int> compactState(getSizeOfCompactState());
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        gatherCompactState(compactState, states, numberOfAgents, i);
+        environmentState[actionIndices[i]] = stepCompact(compactState.begin());
+        scatterCompactState(compactState, states, numberOfAgents, i);
+      }
+    }
+    virtual void observeCompactBatch(int *states, int numberOfAgents, const int *observations) {
+      std::vector<int> compactState(getSizeOfCompactState());
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        int observation = observations[i];
+        gatherCompactState(compactState, states, numberOfAgents, i);
+        observeCompact(compactState.begin(), observation);
+        scatterCompactState(compactState, states, numberOfAgents, i);
+      }
+    }
+  protected:
+    void gatherCompactState(std::vector<int> &compactState, const int *states, int numberOfAgents, int i) {
+      for (int k=0; k<=(int)compactState.size()-1; k++) {
+        compactState[k] = states[k*numberOfAgents+i];
+      }
+    }
+    void scatterCompactState(const std::vector<int> &compactState, int *states, int numberOfAgents, int i) {
+      for (int k=0; k<=(int)compactState.size()-1; k++) {
+        states[k*numberOfAgents+i] = compactState[k];
+      }
+    }
 };
 
 class DeterministicAtomicAgentSimulator: public AtomicAgentSimulator {
@@ -55,14 +130,31 @@ class DeterministicAtomicAgentSimulator: public AtomicAgentSimulator {
       *it += 1;
       return _action;
     }
+    // compact state: none
+    int getSizeOfCompactState() {
+      return 0;
+    }
+    int stepCompact(const std::vector<int>::iterator &it) {
+      return _action;
+    }
+    std::string getPolicyKey() {
+      return "Deterministic" + std::to_string(_action);
+    }
+    void resetCompactStates(int *states, int numberOfAgents) {}
+    void stepCompactBatch(int *states, int numberOfAgents, int *environmentState, const int *actionIndices) {
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        environmentState[actionIndices[i]] = _action;
+      }
+    }
+    void observeCompactBatch(int *states, int numberOfAgents, const int *observations) {}
   private:
     int _action;
 };
 
 class DeterministicAtomicAgent: public AtomicAgent, private DeterministicAtomicAgentSimulator {
   public:
-    DeterministicAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters, int action): DeterministicAtomicAgentSimulator(numberOfActions, action), AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters) {}
-    int act(std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentYAMLNode) {
+    DeterministicAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters, int action): AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters), DeterministicAtomicAgentSimulator(numberOfActions, action) {}
+    int act(EpisodeMetrics::AgentMetrics metrics, YAML::Node &agentYAMLNode) {
       return DeterministicAtomicAgentSimulator::step(_AOH.begin());
     }
     virtual void observe(int &observation) {
@@ -74,7 +166,7 @@ class RandomAtomicAgentSimulator: public AtomicAgentSimulator {
   public:
     RandomAtomicAgentSimulator(const int &numberOfActions): AtomicAgentSimulator(), _numberOfActions(numberOfActions) {}
     int step() { 
-      return std::experimental::randint(0, _numberOfActions-1);
+      return RandomUtils::randint(0, _numberOfActions-1);
     }
     int step(const std::vector<int>::iterator &it) {
       int action = step();
@@ -82,14 +174,31 @@ class RandomAtomicAgentSimulator: public AtomicAgentSimulator {
       *it += 1;
       return action;
     }
+    // compact state: none
+    int getSizeOfCompactState() {
+      return 0;
+    }
+    int stepCompact(const std::vector<int>::iterator &it) {
+      return step();
+    }
+    std::string getPolicyKey() {
+      return "Random" + std::to_string(_numberOfActions);
+    }
+    void resetCompactStates(int *states, int numberOfAgents) {}
+    void stepCompactBatch(int *states, int numberOfAgents, int *environmentState, const int *actionIndices) {
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        environmentState[actionIndices[i]] = step();
+      }
+    }
+    void observeCompactBatch(int *states, int numberOfAgents, const int *observations) {}
   private:
     int _numberOfActions;
 };
 
 class RandomAtomicAgent: public AtomicAgent, private RandomAtomicAgentSimulator {
   public:
-    RandomAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters): RandomAtomicAgentSimulator(numberOfActions), AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters) {}
-    int act(std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentsYAMLNode) {
+    RandomAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters): AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters), RandomAtomicAgentSimulator(numberOfActions) {}
+    int act(EpisodeMetrics::AgentMetrics metrics, YAML::Node &agentsYAMLNode) {
       return RandomAtomicAgentSimulator::step(_AOH.begin());
     }
     virtual void observe(int &observation) {
@@ -0,0 +1,134 @@
+#ifndef EPISODE_METRICS_HPP_
+#define EPISODE_METRICS_HPP_
+
+#include <map>
+#include <vector>
+#include <string>
+#include "Utils.hpp"
+
+// the metrics recorded during an episode
+enum Metric {
+  EPISODIC_RETURN,
+  DISCOUNTED_EPISODIC_RETURN,
+  TIME_PER_ACTION,
+  NUMBER_OF_SIMULATIONS_PER_STEP,
+  NUMBER_OF_PARTICLES_BEFORE_SIMULATION,
+  NUMBER_OF_METRICS
+};
+
+// the metrics of one episode for every agent
+// agents are resolved to slots when the episode starts, so recording a value while acting is an index into preallocated arrays.
+// the string keyed map of the results files is only built when the episode is written
+class EpisodeMetrics {
+  public:
+    typedef std::map<std::string, std::map<std::string, std::vector<double>>> Results;
+
+    // the metrics of one agent, handed to the agent when it acts
+    class AgentMetrics {
+      public:
+        AgentMetrics(EpisodeMetrics *metricsPtr, int slot): _metricsPtr(metricsPtr), _slot(slot) {}
+        void push(Metric metric, double value) {
+          _metricsPtr->push(metric, _slot, value);
+        }
+      private:
+        EpisodeMetrics *_metricsPtr;
+        int _slot;
+    };
+
+    EpisodeMetrics() {}
+
+    EpisodeMetrics(const std::vector<std::string> &agentIDs, int horizon): _agentIDs(agentIDs) {
+      for (int slot=0; slot<=(int)_agentIDs.size()-1; slot++) {
+        _slots[_agentIDs[slot]] = slot;
+      }
+      for (int metric=0; metric<=NUMBER_OF_METRICS-1; metric++) {
+        _values[metric].resize(_agentIDs.size());
+        _statistics[metric].resize(_agentIDs.size());
+        for (auto &values: _values[metric]) {
+          values.reserve(horizon);
+        }
+      }
+    }
+
+    // the metrics of an episode read back from the results files
+    EpisodeMetrics(const std::vector<std::string> &agentIDs, const Results &results): EpisodeMetrics(agentIDs, 0) {
+      for (int metric=0; metric<=NUMBER_OF_METRICS-1; metric++) {
+        auto it = results.find(getName((Metric)metric));
+        if (it == results.end()) {
+          continue;
+        }
+        for (auto &[agentID, values]: it->second) {
+          if (_slots.count(agentID) != 0) {
+            for (auto &value: values) {
+              push((Metric)metric, _slots.at(agentID), value);
+            }
+          }
+        }
+      }
+    }
+
+    int getSlot(const std::string &agentID) const {
+      return _slots.at(agentID);
+    }
+
+    AgentMetrics getAgentMetrics(int slot) {
+      return AgentMetrics(this, slot);
+    }
+
+    // a metric with a value per step
+    void push(Metric metric, int slot, double value) {
+      _values[metric][slot].push_back(value);
+      _statistics[metric][slot].add(value);
+    }
+
+    // a metric with one value per episode, summed over the steps
+    void add(Metric metric, int slot, double value) {
+      std::vector<double> &values = _values[metric][slot];
+      if (values.size() == 0) {
+        values.push_back(value);
+      } else {
+        values[0] += value;
+      }
+    }
+
+    const std::vector<double> &get(Metric metric, int slot) const {
+      return _values[metric][slot];
+    }
+
+    // the statistics of a metric with a value per step
+    const RunningStatistics &getStatistics(Metric metric, int slot) const {
+      return _statistics[metric][slot];
+    }
+
+    // the view of the results files, with the metrics that were recorded
+    Results toResults() const {
+      Results results;
+      for (int metric=0; metric<=NUMBER_OF_METRICS-1; metric++) {
+        for (int slot=0; slot<=(int)_agentIDs.size()-1; slot++) {
+          if (_values[metric][slot].size() != 0) {
+            results[getName((Metric)metric)][_agentIDs[slot]] = _values[metric][slot];
+          }
+        }
+      }
+      return results;
+    }
+
+    static std::string getName(Metric metric) {
+      static const std::string names[NUMBER_OF_METRICS] = {
+        "episodic_return",
+        "discounted_episodic_return",
+        "time_per_action",
+        "number_of_simulations_per_step",
+        "number_of_particles_before_simulation"
+      };
+      return names[metric];
+    }
+
+  private:
+    std::vector<std::string> _agentIDs;
+    std::map<std::string, int> _slots;
+    std::vector<std::vector<double>> _values[NUMBER_OF_METRICS]; // per metric, per slot
+    std::vector<RunningStatistics> _statistics[NUMBER_OF_METRICS];
+};
+
+#endif
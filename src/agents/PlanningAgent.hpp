@@ -7,14 +7,16 @@
 #include <ctime>
 
 // forget about things above
-template <class State> 
+// the simulator type is a template parameter so that calls into a final simulator are resolved statically
+template <class State, class Simulator = Domain::SingleAgentSimulator<State>> 
 class POMCPAtomicAgent: public AtomicAgent {
   public:
   
-    POMCPAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, float discountFactor, const YAML::Node &parameters, Domain::SingleAgentSimulator<State> *simulatorPtr): AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters) {
+    POMCPAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, float discountFactor, const YAML::Node &parameters, Simulator *simulatorPtr): AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters) {
       _numberOfParticles = _parameters["Rollout"]["numberOfParticles"].as<int>();
       _rootObservationNodePtr = new POMCPObservationNode(this);
       _simulatorPtr = simulatorPtr;
+      _simulatorPtr->prepareContext(_simulationContext);
       _planningHorizon = _numberOfStepsToPlan;
       _discountFactor = discountFactor;
       _discountHorizon = parameters["Rollout"]["discountHorizon"].as<float>();
@@ -31,8 +33,10 @@ class POMCPAtomicAgent: public AtomicAgent {
       LOG(INFO) << "A POMCP Agent has been created.";
     }
 
+    // the agent owns its simulator
     ~POMCPAtomicAgent() {
       delete _rootObservationNodePtr;
+      delete _simulatorPtr;
     }
 
     void observe(int &observation) {
@@ -52,14 +56,39 @@ class POMCPAtomicAgent: public AtomicAgent {
         } else if (_particleReinvigoration == true) {
           int numberOfNewParticles = (int)(_rootObservationNodePtr->particles.size()*_particleReinvigorationRate);
           for (int i=0; i<=numberOfNewParticles-1; i++) {
-            _rootObservationNodePtr->particles.push_back(_simulatorPtr->sampleInitialState());
+            _rootObservationNodePtr->particles.push_back(_simulatorPtr->sampleInitialState(_simulationContext));
           }
           VLOG(3) << std::to_string(numberOfNewParticles) + " new particles have been added.";
         }
+        // the storage of the context that only the particles of the pruned branches refer to is released
+        _simulatorPtr->releaseContext([this](std::vector<State*> &states) {
+          _rootObservationNodePtr->collectParticles(states);
+        }, _simulationContext);
       }
       VLOG(2) << "--------------------------------------------------";
     }
 
+    void seed(unsigned int seed) {
+      _simulationContext.randomNumberGenerator.seed(seed);
+    }
+
+    void setPlanningBudget(int numberOfSimulationsPerStep, double numberOfSecondsPerStep, const std::chrono::steady_clock::time_point &deadline) {
+      _numberOfSimulationsPerStep = numberOfSimulationsPerStep;
+      _numberOfSecondsPerStep = numberOfSecondsPerStep;
+      _deadline = deadline;
+    }
+
+    bool getRootStatistics(RootStatistics &statistics) {
+      statistics.visits.assign(_numberOfActions, 0);
+      statistics.values.assign(_numberOfActions, 0.0);
+      for (auto &[action, actionNodePtr]: _rootObservationNodePtr->getChildrenNodes()) {
+        statistics.visits[action] = actionNodePtr->getN();
+        statistics.values[action] = actionNodePtr->getQ();
+      }
+      statistics.numberOfParticles = _rootObservationNodePtr->particles.size();
+      return true;
+    }
+
     void reset() {
       _AOH.clear();
       _AOH.reserve(1 + 2 * _numberOfStepsToPlan);
@@ -71,18 +100,20 @@ class POMCPAtomicAgent: public AtomicAgent {
       delete _rootObservationNodePtr;
       // destroy the previous search tree and build a new one
       _rootObservationNodePtr = new POMCPObservationNode(this);
+      // no particle of the previous episode is left, so the context can release what they used
+      _simulatorPtr->prepareContext(_simulationContext);
 
       // resample particles from initial state distributions
       _rootObservationNodePtr->sampleParticles();
     }
 
-    int act(std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentsYAMLNode){
+    int act(EpisodeMetrics::AgentMetrics metrics, YAML::Node &agentsYAMLNode){
       
       int selectedAction;
-      results["number_of_particles_before_simulation"][_agentID].push_back(_rootObservationNodePtr->particles.size());
+      metrics.push(NUMBER_OF_PARTICLES_BEFORE_SIMULATION, _rootObservationNodePtr->particles.size());
       if (_particleDepleted == true) {
         VLOG(3) << "[Agent " + _agentID + "]: taking random action because of particle depletion";
-        selectedAction = std::experimental::randint(0, _numberOfActions-1);
+        selectedAction = RandomUtils::randint(0, _numberOfActions-1);
       } else {
         VLOG(3) << "[Agent " + _agentID + "]: started to do planning with horizon " + std::to_string(_planningHorizon) + ".";
         double elapsedTime = 0.0;
@@ -92,21 +123,24 @@ class POMCPAtomicAgent: public AtomicAgent {
           if (_numberOfSecondsPerStep > 0.0 && elapsedTime >= _numberOfSecondsPerStep) {
             VLOG(3) << "[Agent " + _agentID + "]: reached planning time.";
             break;
+          } else if (_deadline != std::chrono::steady_clock::time_point::max() && simulationID > 0 && std::chrono::steady_clock::now() >= _deadline) {
+            VLOG(3) << "[Agent " + _agentID + "]: reached planning deadline.";
+            break;
           } else if (_numberOfSimulationsPerStep > 0 && simulationID >= _numberOfSimulationsPerStep) {
             VLOG(3) << "[Agent " + _agentID + "]: reached number of simulations.";
             break;
           } else {
             // do the simulation and accumulate used time
-            auto begin = std::clock();
+            double begin = TimeUtils::threadProcessorTime();
             VLOG(4) << "Simulation " << std::to_string(simulationID) << " started.";
             _rootObservationNodePtr->rootSimulate(_planningHorizon);
-            elapsedTime += double(std::clock()-begin)/CLOCKS_PER_SEC;
+            elapsedTime += TimeUtils::threadProcessorTime() - begin;
             simulationID += 1;
           }
         }
         VLOG(3) << "number of simulations performed: " << std::to_string(simulationID);
         // record the number of simulations per step
-        results["number_of_simulations_per_step"][_agentID].push_back((double)simulationID);
+        metrics.push(NUMBER_OF_SIMULATIONS_PER_STEP, (double)simulationID);
         // pick the greedy action to take
         selectedAction = _rootObservationNodePtr->getBestAction(false);
       }
@@ -124,9 +158,11 @@ class POMCPAtomicAgent: public AtomicAgent {
 
       return selectedAction;
     }
-    Domain::SingleAgentSimulator<State> *_simulatorPtr;
+    Simulator *_simulatorPtr;
+    Domain::SimulationContext _simulationContext; // the random number generator and scratch buffers of this planner
     int _numberOfSimulationsPerStep = -1;
     double _numberOfSecondsPerStep = -1.0;
+    std::chrono::steady_clock::time_point _deadline = std::chrono::steady_clock::time_point::max();
     int _planningHorizon;
     float _explorationConstant;
 
@@ -205,7 +241,7 @@ class POMCPAtomicAgent: public AtomicAgent {
         void sampleParticles() {
           particles.clear();
           for (int particleID=0; particleID <= this->_POMCPAtomicAgentPtr->_numberOfParticles-1; particleID++){
-            particles.push_back(this->_POMCPAtomicAgentPtr->_simulatorPtr->sampleInitialState());
+            particles.push_back(this->_POMCPAtomicAgentPtr->_simulatorPtr->sampleInitialState(this->_POMCPAtomicAgentPtr->_simulationContext));
           }
         }
 
@@ -228,7 +264,7 @@ class POMCPAtomicAgent: public AtomicAgent {
             float reward;
             bool done;
             VLOG(4) << "Doing one step simulation in the simulator";
-            this->_POMCPAtomicAgentPtr->getSimulator()->step(sampledState, action, observation, reward, done);
+            this->_POMCPAtomicAgentPtr->getSimulator()->step(sampledState, action, observation, reward, done, this->_POMCPAtomicAgentPtr->_simulationContext);
             VLOG(4) << "Finished one step simulation in the simulator";
 
             POMCPObservationNode *observationNodePtr;
@@ -241,7 +277,7 @@ class POMCPAtomicAgent: public AtomicAgent {
                 
                 POMCPObservationNode *newObservationNode = new POMCPObservationNode(this->_POMCPAtomicAgentPtr);
             
-                float rolloutReturn = this->_POMCPAtomicAgentPtr->_simulatorPtr->rollout(sampledState, horizon-1, depth+1, this->_POMCPAtomicAgentPtr->_discountHorizon);
+                float rolloutReturn = this->_POMCPAtomicAgentPtr->_simulatorPtr->rollout(sampledState, horizon-1, depth+1, this->_POMCPAtomicAgentPtr->_discountHorizon, this->_POMCPAtomicAgentPtr->_simulationContext);
                 
                 newObservationNode->update(rolloutReturn);
 
@@ -261,7 +297,7 @@ class POMCPAtomicAgent: public AtomicAgent {
         }
 
         State sampleOneParticle() {
-          int index = std::experimental::randint(0, (int)particles.size()-1);
+          int index = RandomUtils::randint(0, (int)particles.size()-1);
           return particles[index];
         }
 
@@ -308,6 +344,20 @@ class POMCPAtomicAgent: public AtomicAgent {
             }
             return node;
         }
+        std::map<int, POMCPActionNode*> &getChildrenNodes() {
+            return _childrenNodes;
+        }
+        // the particles of this node and of the nodes below it
+        void collectParticles(std::vector<State*> &states) {
+            for (auto &particle: particles) {
+                states.push_back(&particle);
+            }
+            for (auto &[action, actionNode]: _childrenNodes) {
+                for (auto &[observation, observationNode]: actionNode->getChildrenNodes()) {
+                    observationNode->collectParticles(states);
+                }
+            }
+        }
         std::vector<State> particles;
       private:
         std::map<int, POMCPActionNode*> _childrenNodes;
@@ -331,10 +381,88 @@ class POMCPAtomicAgent: public AtomicAgent {
     float &getExplorationConstant() {
       return _explorationConstant;
     }
-    Domain::SingleAgentSimulator<State> *&getSimulator() {
+    Simulator *&getSimulator() {
       return _simulatorPtr;
     }
     
 };
 
+template <int H, int L>
+AtomicAgent *makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent(const std::string &agentID, int numberOfActions, int numberOfStepsToPlan, float discountFactor, const YAML::Node &parameters, Domain *domainPtr) {
+  return new POMCPAtomicAgent<Domain::SingleAgentFixedRecurrentInfluenceAugmentedSimulatorState<H, L>, Domain::SingleAgentFixedRecurrentInfluenceAugmentedSimulator<H, L>>(
+    agentID,
+    numberOfActions,
+    numberOfStepsToPlan,
+    discountFactor,
+    parameters,
+    new Domain::SingleAgentFixedRecurrentInfluenceAugmentedSimulator<H, L>(
+      agentID,
+      domainPtr,
+      parameters["Simulator"]
+    )
+  );
+}
+
+// pick the smallest capacity of local states that fits, nullptr if none does
+template <int H>
+AtomicAgent *makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent(int numberOfLocalStates, const std::string &agentID, int numberOfActions, int numberOfStepsToPlan, float discountFactor, const YAML::Node &parameters, Domain *domainPtr) {
+  if (numberOfLocalStates <= 1) {
+    return makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent<H, 1>(agentID, numberOfActions, numberOfStepsToPlan, discountFactor, parameters, domainPtr);
+  } else if (numberOfLocalStates <= 2) {
+    return makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent<H, 2>(agentID, numberOfActions, numberOfStepsToPlan, discountFactor, parameters, domainPtr);
+  } else if (numberOfLocalStates <= 4) {
+    return makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent<H, 4>(agentID, numberOfActions, numberOfStepsToPlan, discountFactor, parameters, domainPtr);
+  } else if (numberOfLocalStates <= 8) {
+    return makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent<H, 8>(agentID, numberOfActions, numberOfStepsToPlan, discountFactor, parameters, domainPtr);
+  } else if (numberOfLocalStates <= 16) {
+    return makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent<H, 16>(agentID, numberOfActions, numberOfStepsToPlan, discountFactor, parameters, domainPtr);
+  } else if (numberOfLocalStates <= 32) {
+    return makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent<H, 32>(agentID, numberOfActions, numberOfStepsToPlan, discountFactor, parameters, domainPtr);
+  }
+  return nullptr;
+}
+
+// POMCP agent on the recurrent influence augmented local simulator
+// particles use the fixed capacity state when the hidden state and the local model fit into one of the capacities
+// and the dynamically sized state otherwise
+inline AtomicAgent *makeRecurrentInfluenceAugmentedPOMCPAtomicAgent(const std::string &agentID, int numberOfActions, int numberOfStepsToPlan, float discountFactor, const YAML::Node &parameters, Domain *domainPtr) {
+  YAML::Node predictorParameters = parameters["Simulator"]["InfluencePredictor"];
+  std::string influencePredictorType = predictorParameters["Type"].as<std::string>();
+  int numberOfHiddenStates = 0;
+  if (influencePredictorType == "Tabular") {
+    numberOfHiddenStates = predictorParameters["historyLength"].as<int>();
+  } else if (influencePredictorType != "Random") {
+    numberOfHiddenStates = predictorParameters["numberOfHiddenStates"].as<int>();
+  }
+  int numberOfLocalStates = domainPtr->getNumberOfLocalStates(agentID);
+
+  AtomicAgent *atomicAgentPtr = nullptr;
+  if (numberOfHiddenStates == 0) {
+    atomicAgentPtr = makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent<0>(numberOfLocalStates, agentID, numberOfActions, numberOfStepsToPlan, discountFactor, parameters, domainPtr);
+  } else if (numberOfHiddenStates <= 2) {
+    atomicAgentPtr = makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent<2>(numberOfLocalStates, agentID, numberOfActions, numberOfStepsToPlan, discountFactor, parameters, domainPtr);
+  } else if (numberOfHiddenStates <= 8) {
+    atomicAgentPtr = makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent<8>(numberOfLocalStates, agentID, numberOfActions, numberOfStepsToPlan, discountFactor, parameters, domainPtr);
+  } else if (numberOfHiddenStates <= 16) {
+    atomicAgentPtr = makeFixedRecurrentInfluenceAugmentedPOMCPAtomicAgent<16>(numberOfLocalStates, agentID, numberOfActions, numberOfStepsToPlan, discountFactor, parameters, domainPtr);
+  }
+  if (atomicAgentPtr != nullptr) {
+    return atomicAgentPtr;
+  }
+
+  VLOG(1) << "No fixed capacity state for " << numberOfLocalStates << " local states and " << numberOfHiddenStates << " hidden states, using the dynamically sized state.";
+  return new POMCPAtomicAgent<Domain::SingleAgentRecurrentInfluenceAugmentedSimulatorState, Domain::SingleAgentRecurrentInfluenceAugmentedSimulator>(
+    agentID,
+    numberOfActions,
+    numberOfStepsToPlan,
+    discountFactor,
+    parameters,
+    new Domain::SingleAgentRecurrentInfluenceAugmentedSimulator(
+      agentID,
+      domainPtr,
+      parameters["Simulator"]
+    )
+  );
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,122 @@
+#ifndef PLANNER_HPP_
+#define PLANNER_HPP_
+
+// planners that run inside the process of a controller, which steps its own environment and tells every planner what its agent observed
+// the domain is loaded once from a config file as for a planning experiment, and each planner is the agent of the AgentComponent section
+// for one agent ID. nothing is written to the filesystem
+
+#include "runners/Experiment.hpp"
+
+class PlanningDomain {
+  public:
+    PlanningDomain(const std::string &pathToConfigurationFile) {
+      _parameters = YAML::LoadFile(pathToConfigurationFile);
+      _domainPtr = Experiment::makeDomain(_parameters["General"]["domain"].as<std::string>(), _parameters);
+    }
+
+    // the planners of the domain have to be destroyed first
+    ~PlanningDomain() {
+      delete _domainPtr;
+    }
+
+    PlanningDomain(const PlanningDomain&) = delete;
+    PlanningDomain &operator=(const PlanningDomain&) = delete;
+
+    Domain *getDomain() {
+      return _domainPtr;
+    }
+
+    const YAML::Node &getParameters() {
+      return _parameters;
+    }
+
+  private:
+    YAML::Node _parameters;
+    Domain *_domainPtr;
+};
+
+// a planner is used by one thread at a time, planners of the same domain can plan in parallel
+class Planner {
+  public:
+    Planner(PlanningDomain &domain, const std::string &agentID): _agentID(agentID), _randomNumberGenerator(std::random_device()()) {
+      auto &agentsSpecification = domain.getDomain()->getAgentsSpecification();
+      if (agentsSpecification.find(agentID) == agentsSpecification.end()) {
+        throw std::invalid_argument("agent " + agentID + " is not in the domain.");
+      }
+      _numberOfActions = agentsSpecification.at(agentID);
+      _horizon = domain.getParameters()["General"]["horizon"].as<int>();
+      YAML::Node agentParameters = domain.getParameters()["AgentComponent"][agentID];
+      _agentPtr = domain.getDomain()->makeAtomicAgent(agentID, agentParameters["Type"].as<std::string>());
+      // the budget of the config, used by steps without a budget of their own
+      YAML::Node rollout = agentParameters["Rollout"];
+      _numberOfSimulationsPerStep = rollout["numberOfSimulationsPerStep"].IsDefined() ? rollout["numberOfSimulationsPerStep"].as<int>() : -1;
+      _numberOfSecondsPerStep = rollout["numberOfSecondsPerStep"].IsDefined() ? rollout["numberOfSecondsPerStep"].as<double>() : -1.0;
+      _agentsYAMLNode["save"] = false;
+      reset();
+    }
+
+    ~Planner() {
+      delete _agentPtr;
+    }
+
+    Planner(const Planner&) = delete;
+    Planner &operator=(const Planner&) = delete;
+
+    // seeds the generators of the agent and the generator the planner lends to the calling thread, the generator of the thread is left to the host
+    void seed(unsigned int seed) {
+      _agentPtr->seed(seed);
+      _randomNumberGenerator.seed(seed);
+    }
+
+    // starts a new episode
+    void reset() {
+      RandomUtils::GeneratorLoan loan(_randomNumberGenerator);
+      _agentPtr->reset();
+      _metrics = EpisodeMetrics({_agentID}, _horizon);
+    }
+
+    // plans until the deadline on the wall clock
+    int act(const std::chrono::steady_clock::time_point &deadline) {
+      RandomUtils::GeneratorLoan loan(_randomNumberGenerator);
+      _agentPtr->setPlanningBudget(-1, -1.0, deadline);
+      return _agentPtr->act(_metrics.getAgentMetrics(0), _agentsYAMLNode);
+    }
+
+    // plans for numberOfSeconds on the wall clock, or with the budget of the config if it is not positive
+    int act(double numberOfSeconds = -1.0) {
+      if (numberOfSeconds > 0.0) {
+        return act(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(numberOfSeconds)));
+      }
+      RandomUtils::GeneratorLoan loan(_randomNumberGenerator);
+      _agentPtr->setPlanningBudget(_numberOfSimulationsPerStep, _numberOfSecondsPerStep);
+      return _agentPtr->act(_metrics.getAgentMetrics(0), _agentsYAMLNode);
+    }
+
+    void observe(int observation) {
+      RandomUtils::GeneratorLoan loan(_randomNumberGenerator);
+      _agentPtr->observe(observation);
+    }
+
+    // false if the agent of the config does not plan
+    bool getRootStatistics(RootStatistics &statistics) {
+      return _agentPtr->getRootStatistics(statistics);
+    }
+
+    int getNumberOfActions() {
+      return _numberOfActions;
+    }
+
+  private:
+    std::string _agentID;
+    AtomicAgent *_agentPtr;
+    int _numberOfActions;
+    int _horizon;
+    int _numberOfSimulationsPerStep;
+    double _numberOfSecondsPerStep;
+    EpisodeMetrics _metrics;
+    YAML::Node _agentsYAMLNode;
+    // lent to the calling thread while the planner is called, agents and simulators without a generator of their own draw from it
+    std::default_random_engine _randomNumberGenerator;
+};
+
+#endif
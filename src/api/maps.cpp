@@ -0,0 +1,94 @@
+#include "api/maps.h"
+#include "api/Planner.hpp"
+
+struct maps_domain: public PlanningDomain {
+  using PlanningDomain::PlanningDomain;
+};
+
+struct maps_planner: public Planner {
+  using Planner::Planner;
+};
+
+namespace {
+
+thread_local std::string lastError;
+
+// no exception leaves the library
+template <class Call>
+int guard(Call call) {
+  try {
+    call();
+    return 0;
+  } catch (const std::exception &e) {
+    lastError = e.what();
+  } catch (...) {
+    lastError = "unknown error.";
+  }
+  return -1;
+}
+
+}
+
+int maps_domain_load(const char *pathToConfigurationFile, maps_domain **domain) {
+  return guard([&]() {
+    *domain = new maps_domain(pathToConfigurationFile);
+  });
+}
+
+void maps_domain_free(maps_domain *domain) {
+  delete domain;
+}
+
+int maps_planner_create(maps_domain *domain, const char *agentID, maps_planner **planner) {
+  return guard([&]() {
+    *planner = new maps_planner(*domain, agentID);
+  });
+}
+
+void maps_planner_free(maps_planner *planner) {
+  delete planner;
+}
+
+int maps_planner_number_of_actions(maps_planner *planner) {
+  return planner->getNumberOfActions();
+}
+
+int maps_planner_seed(maps_planner *planner, unsigned int seed) {
+  return guard([&]() {
+    planner->seed(seed);
+  });
+}
+
+int maps_planner_reset(maps_planner *planner) {
+  return guard([&]() {
+    planner->reset();
+  });
+}
+
+int maps_planner_act(maps_planner *planner, double numberOfSeconds, int *action) {
+  return guard([&]() {
+    *action = planner->act(numberOfSeconds);
+  });
+}
+
+int maps_planner_observe(maps_planner *planner, int observation) {
+  return guard([&]() {
+    planner->observe(observation);
+  });
+}
+
+int maps_planner_root_statistics(maps_planner *planner, int *visits, float *values, int *numberOfParticles) {
+  return guard([&]() {
+    RootStatistics statistics;
+    if (planner->getRootStatistics(statistics) == false) {
+      throw std::invalid_argument("the agent does not plan.");
+    }
+    std::copy(statistics.visits.begin(), statistics.visits.end(), visits);
+    std::copy(statistics.values.begin(), statistics.values.end(), values);
+    *numberOfParticles = statistics.numberOfParticles;
+  });
+}
+
+const char *maps_last_error(void) {
+  return lastError.c_str();
+}
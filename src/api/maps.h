@@ -0,0 +1,40 @@
+#ifndef MAPS_H_
+#define MAPS_H_
+
+/* a C interface to the planners of src/api/Planner.hpp, built as the library libmaps
+ * the functions that can fail return 0 on success and -1 on failure, the reason is then given by maps_last_error
+ * a domain has to outlive its planners, and a planner is used by one thread at a time */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct maps_domain maps_domain;
+typedef struct maps_planner maps_planner;
+
+/* the domain of a config file of a planning experiment */
+int maps_domain_load(const char *pathToConfigurationFile, maps_domain **domain);
+void maps_domain_free(maps_domain *domain);
+
+/* the planner of an agent of the AgentComponent section, reset for a new episode */
+int maps_planner_create(maps_domain *domain, const char *agentID, maps_planner **planner);
+void maps_planner_free(maps_planner *planner);
+
+int maps_planner_number_of_actions(maps_planner *planner);
+/* seeds every random draw of the planner, the generators of the calling thread are left alone */
+int maps_planner_seed(maps_planner *planner, unsigned int seed);
+int maps_planner_reset(maps_planner *planner);
+/* plans for numberOfSeconds on the wall clock, or with the budget of the config if it is not positive */
+int maps_planner_act(maps_planner *planner, double numberOfSeconds, int *action);
+int maps_planner_observe(maps_planner *planner, int observation);
+/* visits and values of the actions at the root of the search tree, both arrays hold maps_planner_number_of_actions elements */
+int maps_planner_root_statistics(maps_planner *planner, int *visits, float *values, int *numberOfParticles);
+
+/* the reason of the last failure in the calling thread */
+const char *maps_last_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,205 @@
+// python bindings of the domains and the simulators, built as the module maps with -DBUILD_PYTHON_BINDINGS=ON
+//
+//   import maps, numpy as np
+//   domain = maps.Domain("configs/GAC/5agent/global.yaml")
+//   simulator = maps.GlobalSimulator(domain, "1")
+//   inputs = np.zeros((1000, horizon-1, len(simulator.inputs)), dtype=np.int32)
+//   outputs = np.zeros((1000, horizon-1, len(simulator.outputs)), dtype=np.int32)
+//   simulator.influence_data(inputs, outputs, seed=0)
+//
+// the arrays are filled in place, without the global interpreter lock, so other python threads run meanwhile
+// a simulator is used by one thread at a time, and a domain has to outlive its simulators
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+#include <optional>
+#include "api/Planner.hpp"
+#include "influence/InfluenceDataSampler.hpp"
+
+namespace py = pybind11;
+
+namespace {
+
+// the memory of an array that is written in place, so neither a copy nor a conversion would do
+template <class T>
+T *getBuffer(py::array &array, const std::string &name, const std::vector<py::ssize_t> &shape) {
+  if (py::isinstance<py::array_t<T>>(array) == false || (array.flags() & py::array::c_style) == 0 || array.writeable() == false) {
+    throw std::invalid_argument(name + " has to be a writeable C contiguous array of " + py::str(py::dtype::of<T>()).cast<std::string>() + ".");
+  }
+  bool sameShape = array.ndim() == (py::ssize_t)shape.size();
+  for (int d=0; sameShape == true && d<=(int)shape.size()-1; d++) {
+    sameShape = array.shape(d) == shape[d];
+  }
+  if (sameShape == false) {
+    std::string expected;
+    for (auto &size: shape) {
+      expected += (expected.empty() ? "" : ", ") + std::to_string(size);
+    }
+    throw std::invalid_argument(name + " has to be of shape (" + expected + ").");
+  }
+  return static_cast<T*>(array.mutable_data());
+}
+
+// checked before a simulator is built for the agent
+const std::string &checkAgent(PlanningDomain &domain, const std::string &agentID) {
+  if (domain.getDomain()->getAgentsSpecification().count(agentID) == 0) {
+    throw std::invalid_argument("agent " + agentID + " is not in the domain.");
+  }
+  return agentID;
+}
+
+// a simulator with a simulation context of its own
+template <class State, class Simulator>
+class PythonSimulator {
+  public:
+    PythonSimulator(PlanningDomain &domain, const std::string &agentID, Simulator *simulatorPtr): _simulatorPtr(simulatorPtr) {
+      _numberOfActions = domain.getDomain()->getAgentsSpecification().at(agentID);
+      _simulatorPtr->prepareContext(_context);
+    }
+
+    virtual ~PythonSimulator() {
+      delete _simulatorPtr;
+    }
+
+    // episodes of random actions of the agent, actions and observations are int32 and rewards float32 arrays of episodes x steps
+    void rollout(py::array actions, py::array observations, py::array rewards, std::optional<unsigned int> seed) {
+      if (actions.ndim() != 2) {
+        throw std::invalid_argument("actions has to be an array of episodes x steps.");
+      }
+      int numberOfEpisodes = actions.shape(0);
+      int horizon = actions.shape(1);
+      int *actionsPtr = getBuffer<int32_t>(actions, "actions", {numberOfEpisodes, horizon});
+      int *observationsPtr = getBuffer<int32_t>(observations, "observations", {numberOfEpisodes, horizon});
+      float *rewardsPtr = getBuffer<float>(rewards, "rewards", {numberOfEpisodes, horizon});
+
+      py::gil_scoped_release release;
+      std::lock_guard<std::mutex> lock(_mutex);
+      this->seed(seed);
+      RandomUtils::GeneratorLoan loan(_context.randomNumberGenerator);
+      int observation;
+      float reward;
+      bool done;
+      for (int i=0; i<=numberOfEpisodes-1; i++) {
+        State state = _simulatorPtr->sampleInitialState(_context);
+        for (int step=0; step<=horizon-1; step++) {
+          int action = RandomUtils::randint(0, _numberOfActions-1);
+          _simulatorPtr->step(state, action, observation, reward, done, _context);
+          actionsPtr[(long)i*horizon+step] = action;
+          observationsPtr[(long)i*horizon+step] = observation;
+          rewardsPtr[(long)i*horizon+step] = reward;
+        }
+        // no state of the episode is left, so the context releases what its states used
+        _simulatorPtr->releaseContext([](std::vector<State*> &states) {}, _context);
+      }
+    }
+
+  protected:
+    Simulator *_simulatorPtr;
+    Domain::SimulationContext _context;
+    int _numberOfActions;
+    std::mutex _mutex;
+
+    // the generator of the context, which is lent to the calling thread for the actions and the random agents
+    void seed(std::optional<unsigned int> seed) {
+      if (seed.has_value() == true) {
+        _context.randomNumberGenerator.seed(seed.value());
+      }
+    }
+};
+
+class PythonGlobalSimulator: public PythonSimulator<Domain::SingleAgentGlobalSimulatorState, Domain::SingleAgentGlobalSimulator> {
+  public:
+    PythonGlobalSimulator(PlanningDomain &domain, const std::string &agentID):
+      PythonSimulator(domain, agentID, new Domain::SingleAgentGlobalSimulator(checkAgent(domain, agentID), domain.getDomain(), domain.getParameters()["AgentComponent"])),
+      _sampler(agentID, domain.getDomain(), _simulatorPtr) {}
+
+    // the training data of the influence predictor of the agent, as written by DataGeneration to inputs.pt and outputs.pt
+    // inputs and outputs are int32 arrays of episodes x steps-1 x the number of inputs or outputs
+    void influenceData(py::array inputs, py::array outputs, std::optional<unsigned int> seed) {
+      if (inputs.ndim() != 3 || inputs.shape(1) < 1) {
+        throw std::invalid_argument("inputs has to be an array of episodes x steps-1 x inputs, with at least one step.");
+      }
+      int numberOfEpisodes = inputs.shape(0);
+      int horizon = inputs.shape(1) + 1;
+      int *inputsPtr = getBuffer<int32_t>(inputs, "inputs", {numberOfEpisodes, horizon-1, (py::ssize_t)_sampler.getInputs().size()});
+      int *outputsPtr = getBuffer<int32_t>(outputs, "outputs", {numberOfEpisodes, horizon-1, (py::ssize_t)_sampler.getOutputs().size()});
+
+      py::gil_scoped_release release;
+      std::lock_guard<std::mutex> lock(_mutex);
+      this->seed(seed);
+      RandomUtils::GeneratorLoan loan(_context.randomNumberGenerator);
+      _sampler.sample(numberOfEpisodes, horizon, inputsPtr, outputsPtr, _context);
+    }
+
+    InfluenceDataSampler &getSampler() {
+      return _sampler;
+    }
+
+  private:
+    InfluenceDataSampler _sampler;
+};
+
+class PythonSequentialInfluenceAugmentedSimulator: public PythonSimulator<Domain::SingleAgentSequentialInfluenceAugmentedSimulatorState, Domain::SingleAgentSequentialInfluenceAugmentedSimulator> {
+  public:
+    PythonSequentialInfluenceAugmentedSimulator(PlanningDomain &domain, const std::string &agentID):
+      PythonSimulator(domain, agentID, new Domain::SingleAgentSequentialInfluenceAugmentedSimulator(checkAgent(domain, agentID), domain.getDomain(), domain.getParameters()["AgentComponent"][agentID]["Simulator"])) {}
+};
+
+class PythonRecurrentInfluenceAugmentedSimulator: public PythonSimulator<Domain::SingleAgentRecurrentInfluenceAugmentedSimulatorState, Domain::SingleAgentRecurrentInfluenceAugmentedSimulator> {
+  public:
+    PythonRecurrentInfluenceAugmentedSimulator(PlanningDomain &domain, const std::string &agentID):
+      PythonSimulator(domain, agentID, new Domain::SingleAgentRecurrentInfluenceAugmentedSimulator(checkAgent(domain, agentID), domain.getDomain(), domain.getParameters()["AgentComponent"][agentID]["Simulator"])) {}
+};
+
+template <class PythonSimulatorType>
+py::class_<PythonSimulatorType> bindSimulator(py::module &m, const char *name) {
+  return py::class_<PythonSimulatorType>(m, name)
+    .def(py::init<PlanningDomain&, const std::string&>(), py::arg("domain"), py::arg("agent_id"), py::keep_alive<1, 2>())
+    .def("rollout", &PythonSimulatorType::rollout, py::arg("actions"), py::arg("observations"), py::arg("rewards"), py::arg("seed") = py::none());
+}
+
+}
+
+PYBIND11_MODULE(maps, m) {
+  m.doc() = "the domains and the simulators of influence-augmented online planning";
+
+  py::class_<TwoStageDynamicBayesianNetwork>(m, "Network")
+    .def_property_readonly("state_variables", &TwoStageDynamicBayesianNetwork::getStateVariables)
+    .def_property_readonly("number_of_variables", &TwoStageDynamicBayesianNetwork::getNumberOfVariables)
+    .def("index_of", &TwoStageDynamicBayesianNetwork::getIndexOfVariable, py::arg("name"))
+    .def("local_model", [](TwoStageDynamicBayesianNetwork &network, const std::string &agentID) {
+      std::vector<std::string> localFactors, localStates, sourceFactors, destinationFactors, dSeparationSetPerStage;
+      network.constructLocalModel(agentID, localFactors, localStates, sourceFactors, destinationFactors, dSeparationSetPerStage);
+      py::dict localModel;
+      localModel["local_factors"] = localFactors;
+      localModel["local_states"] = localStates;
+      localModel["source_factors"] = sourceFactors;
+      localModel["destination_factors"] = destinationFactors;
+      localModel["d_separation_set"] = dSeparationSetPerStage;
+      return localModel;
+    }, py::arg("agent_id"));
+
+  py::class_<PlanningDomain>(m, "Domain")
+    .def(py::init<const std::string&>(), py::arg("path_to_configuration_file"))
+    .def_property_readonly("network", [](PlanningDomain &domain) {
+      return domain.getDomain()->getDBNPtr();
+    }, py::return_value_policy::reference_internal)
+    .def_property_readonly("agent_ids", [](PlanningDomain &domain) {
+      return domain.getDomain()->getListOfAgentIDs();
+    })
+    .def("number_of_actions", [](PlanningDomain &domain, const std::string &agentID) {
+      return domain.getDomain()->getAgentsSpecification().at(agentID);
+    }, py::arg("agent_id"));
+
+  bindSimulator<PythonGlobalSimulator>(m, "GlobalSimulator")
+    .def("influence_data", &PythonGlobalSimulator::influenceData, py::arg("inputs"), py::arg("outputs"), py::arg("seed") = py::none())
+    .def_property_readonly("inputs", [](PythonGlobalSimulator &simulator) {
+      return simulator.getSampler().getInputs();
+    })
+    .def_property_readonly("outputs", [](PythonGlobalSimulator &simulator) {
+      return simulator.getSampler().getOutputs();
+    });
+  bindSimulator<PythonSequentialInfluenceAugmentedSimulator>(m, "SequentialInfluenceAugmentedSimulator");
+  bindSimulator<PythonRecurrentInfluenceAugmentedSimulator>(m, "RecurrentInfluenceAugmentedSimulator");
+}
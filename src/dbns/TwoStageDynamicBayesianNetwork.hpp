@@ -100,7 +100,37 @@ class TwoStageDynamicBayesianNetwork {
       
     }
 
-    TwoStageDynamicBayesianNetwork(std::string yamlFilePath){
+    TwoStageDynamicBayesianNetwork(std::string yamlFilePath): TwoStageDynamicBayesianNetwork(loadNetwork(yamlFilePath)) {}
+
+    // a network in the format of the yaml files, for example generated by a domain
+    TwoStageDynamicBayesianNetwork(const YAML::Node &config){
+      for (YAML::const_iterator it = config.begin(); it != config.end(); ++it){
+        std::string key = it->first.as<std::string>();
+        _twoStageDynamicBayesianNetworkVariables[key] = new TwoStageDynamicBayesianNetworkVariable(key, it->second);
+        if (_twoStageDynamicBayesianNetworkVariables.at(key)->isStateVariable() == true) {
+          _stateVariables.push_back(key);
+        } 
+      }
+      // dense indices of variables, in the order of their names
+      std::set<const ConditionalProbabilityTable*> conditionalProbabilityTables;
+      for (auto &[key, variablePtr]: _twoStageDynamicBayesianNetworkVariables) {
+        std::vector<int> numbersOfParentValues;
+        for (auto &parentName: variablePtr->getListOfParents()) {
+          auto parentIt = _twoStageDynamicBayesianNetworkVariables.find(parentName);
+          numbersOfParentValues.push_back(parentIt == _twoStageDynamicBayesianNetworkVariables.end() ? 0 : parentIt->second->getNumberOfValues());
+        }
+        variablePtr->checkParents(numbersOfParentValues);
+        _indicesOfVariables[key] = _variablesByIndex.size();
+        _variablesByIndex.push_back(variablePtr);
+        if (variablePtr->getConditionalProbabilityTable() != nullptr) {
+          conditionalProbabilityTables.insert(variablePtr->getConditionalProbabilityTable());
+        }
+      }
+      _randomNumberGenerator.seed(time(0));
+      LOG(INFO) << "Two stage dynamic bayesian network has been built with " << conditionalProbabilityTables.size() << " distinct conditional probability tables.";
+    }
+
+    static YAML::Node loadNetwork(const std::string &yamlFilePath) {
       LOG(INFO) << "Loading " << yamlFilePath << ".";
       clock_t begin = std::clock();
       std::ifstream ifs(yamlFilePath);
@@ -109,15 +139,7 @@ class TwoStageDynamicBayesianNetwork {
       YAML::Node config = YAML::Load(content);
       double elapsed_seconds = double(std::clock()-begin) / CLOCKS_PER_SEC;
       LOG(INFO) << "Yaml file loaded after " << std::to_string(elapsed_seconds) << " seconds. Constructing the DBN ...";
-      for (YAML::const_iterator it = config.begin(); it != config.end(); ++it){
-        std::string key = it->first.as<std::string>();
-        _twoStageDynamicBayesianNetworkVariables[key] = new TwoStageDynamicBayesianNetworkVariable(key, config[key], &_randomNumberGenerator);
-        if (_twoStageDynamicBayesianNetworkVariables.at(key)->isStateVariable() == true) {
-          _stateVariables.push_back(key);
-        } 
-      }
-      _randomNumberGenerator.seed(time(0));
-      LOG(INFO) << "Two stage dynamic bayesian network has been built.";
+      return config;
     }
 
     ~TwoStageDynamicBayesianNetwork() {
@@ -127,27 +149,78 @@ class TwoStageDynamicBayesianNetwork {
     }
 
     // sample variables sequentially acc#include <algorithm>rding to the order specified by the sampling mode
-    void step(std::map<std::string, int> &state, const std::string &samplingMode){
-      for (auto const &varName: _samplingOrders[samplingMode]){
+    // the network is only read here, so threads can step concurrently with their own random number generators
+    void step(std::map<std::string, int> &state, const std::string &samplingMode, std::default_random_engine &randomNumberGenerator){
+      const std::vector<std::string> &samplingOrder = _samplingOrders.at(samplingMode);
+      for (auto const &varName: samplingOrder){
         std::vector<int> indicesOfConditionalVariables;
-        for (auto const& parentName: _twoStageDynamicBayesianNetworkVariables[varName]->getListOfParents()){
+        auto variablePtr = _twoStageDynamicBayesianNetworkVariables.at(varName);
+        for (auto const& parentName: variablePtr->getListOfParents()){
           try {
             indicesOfConditionalVariables.push_back(state[parentName]);
           } catch (const std::exception& e) {
             LOG(FATAL) << e.what();
           }
         }
-        auto sampledValue = _twoStageDynamicBayesianNetworkVariables[varName]->sample(indicesOfConditionalVariables);
+        auto sampledValue = variablePtr->sample(indicesOfConditionalVariables, randomNumberGenerator);
         state[varName] = sampledValue ;
       }
       // update state variables
-      for (auto const &key: _samplingOrders[samplingMode]) {
+      for (auto const &key: samplingOrder) {
         if (key[0] == 'x') {
           state.at(key.substr(0, key.size()-1)) = state.at(key);
         }
       }
     }
 
+    // step with the random number generator of the network, not reentrant
+    void step(std::map<std::string, int> &state, const std::string &samplingMode){
+      step(state, samplingMode, _randomNumberGenerator);
+    }
+
+    // one step on a dense state, indexed by getIndexOfVariable, along the same sampling order as the map based step
+    void step(std::vector<int> &state, const std::string &samplingMode, std::default_random_engine &randomNumberGenerator){
+      const DenseSamplingOrder &samplingOrder = _denseSamplingOrders.at(samplingMode);
+      std::vector<int> indicesOfConditionalVariables;
+      indicesOfConditionalVariables.reserve(samplingOrder.maximumNumberOfParents);
+      for (auto const &entry: samplingOrder.entries) {
+        indicesOfConditionalVariables.clear();
+        for (int parentIndex: entry.parentIndices) {
+          indicesOfConditionalVariables.push_back(state[parentIndex]);
+        }
+        state[entry.variableIndex] = entry.variablePtr->sample(indicesOfConditionalVariables, randomNumberGenerator);
+      }
+      // update state variables
+      for (auto const &[nextStageIndex, index]: samplingOrder.stateUpdates) {
+        state[index] = state[nextStageIndex];
+      }
+    }
+
+    bool hasVariable(const std::string &varName) {
+      return _twoStageDynamicBayesianNetworkVariables.count(varName) != 0;
+    }
+
+    int getIndexOfVariable(const std::string &varName) {
+      return _indicesOfVariables.at(varName);
+    }
+
+    int getNumberOfVariables() {
+      return _variablesByIndex.size();
+    }
+
+    TwoStageDynamicBayesianNetworkVariable *getVariable(int index) {
+      return _variablesByIndex[index];
+    }
+
+    // a dense state with the values of the given variables, all others are 0
+    std::vector<int> toDenseState(const std::map<std::string, int> &state) {
+      std::vector<int> denseState(_variablesByIndex.size(), 0);
+      for (auto &[key, val]: state) {
+        denseState[_indicesOfVariables.at(key)] = val;
+      }
+      return denseState;
+    }
+
     // compute a sampling order given set of input variables and output variables and assign a name (sampling mode) to it
     void computeSamplingOrder(const std::set<std::string> &setOfInputVariables, const std::set<std::string> &setOfOutputVariables, const std::string &samplingMode){
       std::set<std::string> toSamplePool;
@@ -157,24 +230,48 @@ class TwoStageDynamicBayesianNetwork {
       LOG(INFO) << "Computing sampling order with inputs: " + PrintUtils::setToTupleString<std::string>(sampledPool);
       LOG(INFO) << "and outputs: " + PrintUtils::setToTupleString<std::string>(toSamplePool);
       _samplingOrders[samplingMode].clear();
-      while (toSamplePool.size() > 0){
-        for (auto &var: toSamplePool){
-          bool allParentsAreSampled = true;
-          for (auto &parentName: _twoStageDynamicBayesianNetworkVariables[var]->getListOfParents()){
-            if (sampledPool.find(parentName) == sampledPool.end()){
-              allParentsAreSampled = false;
-              toSamplePool.insert(parentName);
-            }
+      // the outputs and, recursively, the parents that are not inputs are sampled
+      std::vector<std::string> toVisit(toSamplePool.begin(), toSamplePool.end());
+      while (toVisit.size() > 0) {
+        std::string var = toVisit.back();
+        toVisit.pop_back();
+        for (auto &parentName: _twoStageDynamicBayesianNetworkVariables.at(var)->getListOfParents()) {
+          if (sampledPool.find(parentName) == sampledPool.end() && toSamplePool.insert(parentName).second == true) {
+            toVisit.push_back(parentName);
           }
-          if (allParentsAreSampled == true){
-              _samplingOrders[samplingMode].push_back(var);
-              sampledPool.insert(var);
-              break;
+        }
+      }
+      // the first variable (by name) whose parents are all sampled goes next, in linear rather than quadratic time
+      std::map<std::string, int> numberOfUnsampledParents;
+      std::map<std::string, std::vector<std::string>> children;
+      std::set<std::string> readyPool;
+      for (auto &var: toSamplePool) {
+        int &count = numberOfUnsampledParents[var];
+        for (auto &parentName: _twoStageDynamicBayesianNetworkVariables.at(var)->getListOfParents()) {
+          if (toSamplePool.find(parentName) != toSamplePool.end()) {
+            count += 1;
+            children[parentName].push_back(var);
+          }
+        }
+        if (count == 0) {
+          readyPool.insert(var);
+        }
+      }
+      while (readyPool.size() > 0) {
+        std::string var = *readyPool.begin();
+        readyPool.erase(readyPool.begin());
+        _samplingOrders[samplingMode].push_back(var);
+        for (auto &child: children[var]) {
+          if (--numberOfUnsampledParents[child] == 0) {
+            readyPool.insert(child);
           }
         }
-        toSamplePool.erase(_samplingOrders[samplingMode].back());
+      }
+      if (_samplingOrders[samplingMode].size() != toSamplePool.size()) {
+        throw std::invalid_argument("The DBN has a cycle among the variables to sample.");
       }
       LOG(INFO) << "sampling order: " + PrintUtils::vectorToString<std::string>(_samplingOrders.at(samplingMode));
+      compileDenseSamplingOrder(samplingMode);
     }
 
     TwoStageDynamicBayesianNetworkVariable *&getVariable(std::string &varName) {
@@ -229,26 +326,64 @@ class TwoStageDynamicBayesianNetwork {
       return numberOfActions;
     }
 
-    std::map<std::string, int> sampleInitialState() {
+    std::map<std::string, int> sampleInitialState(std::default_random_engine &randomNumberGenerator) {
       std::map<std::string, int> initialMap;
       for (auto &key: _stateVariables) {
-        initialMap[key] = _twoStageDynamicBayesianNetworkVariables.at(key)->sampleInitialValue();
+        initialMap[key] = _twoStageDynamicBayesianNetworkVariables.at(key)->sampleInitialValue(randomNumberGenerator);
       }
       return initialMap;
     }
 
+    std::map<std::string, int> sampleInitialState() {
+      return sampleInitialState(_randomNumberGenerator);
+    }
+
     std::vector<std::string> &getStateVariables() {
       return _stateVariables;
     }
 
+    // the random number generator of the network, used by callers without a simulation context
     std::default_random_engine &getRandomNumberGenerator() {
       return _randomNumberGenerator;
     }
 
   private:
+    // a sampling order resolved to variable indices for the dense step
+    struct DenseSamplingOrder {
+      struct Entry {
+        int variableIndex;
+        TwoStageDynamicBayesianNetworkVariable *variablePtr;
+        std::vector<int> parentIndices;
+      };
+      std::vector<Entry> entries;
+      std::vector<std::pair<int, int>> stateUpdates; // from x' to x
+      int maximumNumberOfParents = 0;
+    };
+
     std::map<std::string, TwoStageDynamicBayesianNetworkVariable*> _twoStageDynamicBayesianNetworkVariables;
     std::vector<std::string> _stateVariables;
     std::map<std::string, std::vector<std::string>> _samplingOrders;
+    std::map<std::string, DenseSamplingOrder> _denseSamplingOrders;
+    std::map<std::string, int> _indicesOfVariables;
+    std::vector<TwoStageDynamicBayesianNetworkVariable*> _variablesByIndex;
+
+    void compileDenseSamplingOrder(const std::string &samplingMode) {
+      DenseSamplingOrder denseSamplingOrder;
+      for (auto const &varName: _samplingOrders.at(samplingMode)) {
+        DenseSamplingOrder::Entry entry;
+        entry.variableIndex = _indicesOfVariables.at(varName);
+        entry.variablePtr = _twoStageDynamicBayesianNetworkVariables.at(varName);
+        for (auto const &parentName: entry.variablePtr->getListOfParents()) {
+          entry.parentIndices.push_back(_indicesOfVariables.at(parentName));
+        }
+        denseSamplingOrder.maximumNumberOfParents = std::max(denseSamplingOrder.maximumNumberOfParents, (int)entry.parentIndices.size());
+        denseSamplingOrder.entries.push_back(entry);
+        if (varName[0] == 'x' && StringUtils::lastBitIsPrime(varName) == true) {
+          denseSamplingOrder.stateUpdates.push_back({entry.variableIndex, _indicesOfVariables.at(varName.substr(0, varName.size()-1))});
+        }
+      }
+      _denseSamplingOrders[samplingMode] = denseSamplingOrder;
+    }
     std::default_random_engine _randomNumberGenerator;
     static bool _factorComparator(const std::string &a_, const std::string &b_) {
       auto a = StringUtils::removeLastPrime(a_);
@@ -270,7 +405,7 @@ class TwoStageDynamicBayesianNetwork {
           // find the common prefix of two strings
           int idx = 0;
           while (true) {
-            if (idx > a.size()-1 || idx > b.size()-1) {
+            if (idx > (int)a.size()-1 || idx > (int)b.size()-1) {
               break;
             } else if (a[idx] != b[idx]) {
               break;
@@ -3,23 +3,154 @@
 
 #include<cmath>
 #include <experimental/random>
+#include <cstring>
+#include <numeric>
+#include <algorithm>
+#include "Utils.hpp"
 
 #define CPT 0
 #define SUM 1
 #define EXPSUM 2
 #define NOISYEXPSUM 3
+// parametric modes, sampled in time linear in the number of parents instead of from a table. a parent is active if its index is not 0
+// NOISYOR: {leak: 0.1, weights: [0.5, ...]}, the variable is 1 unless the leak and every active parent fail to cause it
+// NOISYMAX: {leak: [...], contributions: [[[...], ...], ...]}, the variable is the largest of the contributions of its parents and the leak.
+//   the leak and the contribution of a parent for each of its indices above 0 are distributions over the values, inactive parents contribute 0
+// LOGISTIC: {bias: -1.0, weights: [0.5, ...]}, the variable is 1 with probability sigmoid(bias + sum of weight times index of the parent)
+// THRESHOLD: {threshold: 2, probabilities: [0.0, 1.0]}, the variable is 1 with the second probability if at least threshold parents are active
+//   and with the first otherwise
+#define NOISYOR 4
+#define NOISYMAX 5
+#define LOGISTIC 6
+#define THRESHOLD 7
+
+// an immutable conditional probability table with a row for every combination of the values of the parents
+// tables are hash-consed when the network is loaded, so variables with identical tables point to one shared table,
+// and rows with identical distributions within a table point to one distribution
+class ConditionalProbabilityTable {
+  public:
+    ConditionalProbabilityTable(const std::map<std::vector<int>, std::vector<float>> &table) {
+      // the number of values of every parent is inferred from the largest index in the table
+      int numberOfParents = table.size() == 0 ? 0 : table.begin()->first.size();
+      _numbersOfParentValues.assign(numberOfParents, 1);
+      for (auto &[parentValues, probabilities]: table) {
+        for (int i=0; i<=numberOfParents-1; i++) {
+          _numbersOfParentValues[i] = std::max(_numbersOfParentValues[i], parentValues[i]+1);
+        }
+      }
+      _strides.assign(numberOfParents, 1);
+      long numberOfRows = 1;
+      for (int i=numberOfParents-1; i>=0; i--) {
+        _strides[i] = numberOfRows;
+        numberOfRows *= _numbersOfParentValues[i];
+      }
+      if (numberOfRows > (1 << 24)) {
+        throw std::invalid_argument("the conditional probability table is too sparse to be stored densely.");
+      }
+      _rows.assign(numberOfRows, -1);
+      std::map<std::vector<float>, int> indicesOfDistributions;
+      for (auto &[parentValues, probabilities]: table) {
+        auto [it, inserted] = indicesOfDistributions.insert({probabilities, (int)_distributions.size()});
+        if (inserted == true) {
+          _distributions.emplace_back(probabilities.begin(), probabilities.end());
+          _probabilities.push_back(probabilities);
+        }
+        _rows[getRow(parentValues)] = it->second;
+      }
+      _numberOfDefinedRows = table.size();
+    }
+
+    // whether the table holds exactly the rows of table, with the same bits of the probabilities
+    bool equals(const std::map<std::vector<int>, std::vector<float>> &table) const {
+      if ((int)table.size() != _numberOfDefinedRows) {
+        return false;
+      }
+      for (auto &[parentValues, probabilities]: table) {
+        if (parentValues.size() != _strides.size()) {
+          return false;
+        }
+        for (int i=0; i<=(int)parentValues.size()-1; i++) {
+          if (parentValues[i] < 0 || parentValues[i] >= _numbersOfParentValues[i]) {
+            return false;
+          }
+        }
+        int row = _rows[getRow(parentValues)];
+        if (row < 0 || HashUtils::sameBytes(_probabilities[row], probabilities) == false) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // the distribution given the indices of the parents, out of range if the table has no row for them
+    std::discrete_distribution<int> &getDistribution(const std::vector<int> &parentValues) const {
+      if (parentValues.size() != _strides.size()) {
+        throw std::out_of_range("the number of parents does not match the conditional probability table.");
+      }
+      for (int i=0; i<=(int)parentValues.size()-1; i++) {
+        if (parentValues[i] < 0 || parentValues[i] >= _numbersOfParentValues[i]) {
+          throw std::out_of_range("the conditional probability table has no row for the values of the parents.");
+        }
+      }
+      int row = _rows[getRow(parentValues)];
+      if (row < 0) {
+        throw std::out_of_range("the conditional probability table has no row for the values of the parents.");
+      }
+      return _distributions[row];
+    }
+
+    // the table shared by all variables with the same table
+    // the registry keeps a hash of the table, tables with the same hash are compared with the table
+    static std::shared_ptr<const ConditionalProbabilityTable> getShared(const std::map<std::vector<int>, std::vector<float>> &table) {
+      size_t hash = table.size();
+      for (auto &[parentValues, probabilities]: table) {
+        hash = HashUtils::combine(hash, HashUtils::hashBytes(parentValues));
+        hash = HashUtils::combine(hash, HashUtils::hashBytes(probabilities));
+      }
+      return SharedResourceRegistry<ConditionalProbabilityTable>::get(hash, [&](const ConditionalProbabilityTable &sharedTable) {
+        return sharedTable.equals(table);
+      }, [&]() {
+        return new ConditionalProbabilityTable(table);
+      });
+    }
+
+  private:
+    std::vector<int> _numbersOfParentValues;
+    std::vector<int> _strides;
+    std::vector<int> _rows; // index of the distribution of every row, -1 for missing rows
+    int _numberOfDefinedRows;
+    std::vector<std::vector<float>> _probabilities; // the probabilities every distribution was built from
+    // sampling only reads the parameters of a distribution, so tables are shared by threads like the rest of the network
+    mutable std::vector<std::discrete_distribution<int>> _distributions;
+
+    int getRow(const std::vector<int> &parentValues) const {
+      int row = 0;
+      for (int i=0; i<=(int)parentValues.size()-1; i++) {
+        row += parentValues[i] * _strides[i];
+      }
+      return row;
+    }
+};
 
 class TwoStageDynamicBayesianNetworkVariable {
   public:
     std::string name;
 
-    TwoStageDynamicBayesianNetworkVariable(std::string name, const YAML::Node &info, std::default_random_engine *randomNumberGeneratorPtr){
+    TwoStageDynamicBayesianNetworkVariable(std::string name, const YAML::Node &info){
       this->name = name;
       _listOfParents = info["parents"].as<std::vector<std::string>>();
       if (info["values"].IsDefined()) {
-        _listOfValues = info["values"].as<std::vector<float>>();
+        // value lists are shared like the tables
+        std::vector<float> values = info["values"].as<std::vector<float>>();
+        _listOfValuesPtr = SharedResourceRegistry<std::vector<float>>::get(HashUtils::hashBytes(values), [&](const std::vector<float> &sharedValues) {
+          return HashUtils::sameBytes(sharedValues, values);
+        }, [&]() {
+          return new std::vector<float>(values);
+        });
+      } else {
+        _listOfValuesPtr = std::make_shared<const std::vector<float>>();
       }
-      _numberOfValues = _listOfValues.size();
+      _numberOfValues = _listOfValuesPtr->size();
 
       if (_listOfParents.size() != 0) {
         _mode = CPT;
@@ -31,22 +162,83 @@ class TwoStageDynamicBayesianNetworkVariable {
             _mode = EXPSUM;
           } else if (modeStr == "NOISYEXPSUM") {
             _mode = NOISYEXPSUM;
+          } else if (modeStr == "NOISYOR") {
+            _mode = NOISYOR;
+          } else if (modeStr == "NOISYMAX") {
+            _mode = NOISYMAX;
+          } else if (modeStr == "LOGISTIC") {
+            _mode = LOGISTIC;
+          } else if (modeStr == "THRESHOLD") {
+            _mode = THRESHOLD;
           } else {
             _mode = CPT;
           }
         }
         if (_mode == CPT) {
           YAML::Node conditionalProbabilityTable = info["CPT"];
+          std::map<std::vector<int>, std::vector<float>> table;
           for (YAML::const_iterator it = conditionalProbabilityTable.begin(); it != conditionalProbabilityTable.end(); ++it){
-            std::vector<int> conditionalIndices = it->first.as<std::vector<int>>();
-            std::vector<float> probabilities = it->second.as<std::vector<float>>();
-            _conditionalProbabilityDistribution[conditionalIndices] = std::unique_ptr<std::discrete_distribution<int>>(new std::discrete_distribution<int>(probabilities.begin(), probabilities.end()));
+            table[it->first.as<std::vector<int>>()] = it->second.as<std::vector<float>>();
           }
+          _conditionalProbabilityTablePtr = ConditionalProbabilityTable::getShared(table);
         } else if (_mode == EXPSUM) {
           _expSumBase = info["EXPSUM"]["base"].as<int>();
         } else if (_mode == NOISYEXPSUM) {
           _expSumBase = info["NOISYEXPSUM"]["base"].as<int>();
           _noise = info["NOISYEXPSUM"]["noise"].as<float>();
+        } else if (_mode == NOISYOR) {
+          _bias = info["NOISYOR"]["leak"].IsDefined() ? info["NOISYOR"]["leak"].as<double>() : 0.0;
+          _weights = info["NOISYOR"]["weights"].as<std::vector<double>>();
+        } else if (_mode == LOGISTIC) {
+          _bias = info["LOGISTIC"]["bias"].IsDefined() ? info["LOGISTIC"]["bias"].as<double>() : 0.0;
+          _weights = info["LOGISTIC"]["weights"].as<std::vector<double>>();
+        } else if (_mode == THRESHOLD) {
+          _threshold = info["THRESHOLD"]["threshold"].as<int>();
+          _weights = info["THRESHOLD"]["probabilities"].IsDefined() ? info["THRESHOLD"]["probabilities"].as<std::vector<double>>() : std::vector<double>{0.0, 1.0};
+        } else if (_mode == NOISYMAX) {
+          // cumulative distributions, so that the distribution of the largest contribution is their product
+          std::vector<double> leak(std::max(_numberOfValues, 1), 0.0);
+          leak[0] = 1.0;
+          if (info["NOISYMAX"]["leak"].IsDefined()) {
+            leak = info["NOISYMAX"]["leak"].as<std::vector<double>>();
+            if ((int)leak.size() != _numberOfValues) {
+              throw std::invalid_argument(name + " needs a leak over all of its values.");
+            }
+            checkProbabilities(leak, "a leak");
+          }
+          _cumulativeLeak = toCumulative(leak);
+          for (auto &contributions: info["NOISYMAX"]["contributions"].as<std::vector<std::vector<std::vector<double>>>>()) {
+            _cumulativeContributions.emplace_back();
+            for (auto &contribution: contributions) {
+              if (contribution.size() != leak.size()) {
+                throw std::invalid_argument(name + " needs contributions over as many values as the leak.");
+              }
+              checkProbabilities(contribution, "contributions");
+              _cumulativeContributions.back().push_back(toCumulative(contribution));
+            }
+          }
+        }
+        if ((_mode == NOISYOR || _mode == LOGISTIC || _mode == THRESHOLD) && _numberOfValues != 2) {
+          throw std::invalid_argument(name + " is binary in its mode and needs two values.");
+        } else if (_mode == NOISYMAX && _numberOfValues < 2) {
+          throw std::invalid_argument(name + " needs at least two values.");
+        }
+        if ((_mode == NOISYOR || _mode == LOGISTIC) && _weights.size() != _listOfParents.size()) {
+          throw std::invalid_argument(name + " needs a weight for every parent.");
+        } else if (_mode == THRESHOLD && _weights.size() != 2) {
+          throw std::invalid_argument(name + " needs the probabilities below and at the threshold.");
+        } else if (_mode == NOISYMAX && _cumulativeContributions.size() != _listOfParents.size()) {
+          throw std::invalid_argument(name + " needs the contributions of every parent.");
+        }
+        if (_mode == NOISYOR) {
+          checkProbabilities({_bias}, "a leak");
+          checkProbabilities(_weights, "weights");
+        } else if (_mode == THRESHOLD) {
+          checkProbabilities(_weights, "probabilities");
+        } else if (_mode == LOGISTIC) {
+          if (std::isfinite(_bias) == false || std::any_of(_weights.begin(), _weights.end(), [](double weight) { return std::isfinite(weight) == false; })) {
+            throw std::invalid_argument(name + " needs a finite bias and weights.");
+          }
         }
       }
 
@@ -55,18 +247,29 @@ class TwoStageDynamicBayesianNetworkVariable {
       } 
 
       if (info["initial_dist"].IsDefined() == true) {
-        LOG(INFO) << name;
+        VLOG(2) << name;
         auto initialProbabilities = info["initial_dist"].as<std::vector<float>>();
         _initialDist = std::unique_ptr<std::discrete_distribution<int>>(new std::discrete_distribution<int>(initialProbabilities.begin(), initialProbabilities.end()));
       }
-
-      this->_randomNumberGeneratorPtr = randomNumberGeneratorPtr;
     }
 
     std::vector<std::string> &getListOfParents(){
       return _listOfParents;
     }
 
+    // the parameters that depend on the number of values of the parents, checked once the network has every variable
+    // a number of values of 0 is not checked, as for parents without a list of values
+    void checkParents(const std::vector<int> &numbersOfParentValues) {
+      if (_mode != NOISYMAX) {
+        return;
+      }
+      for (int i=0; i<=(int)_listOfParents.size()-1; i++) {
+        if (numbersOfParentValues[i] != 0 && (int)_cumulativeContributions[i].size() != numbersOfParentValues[i]-1) {
+          throw std::invalid_argument(name + " needs a contribution of " + _listOfParents[i] + " for each of its values above the first.");
+        }
+      }
+    }
+
     int getNumberOfInputs(){
       return _listOfParents.size();
     }
@@ -75,15 +278,16 @@ class TwoStageDynamicBayesianNetworkVariable {
       return _numberOfValues;
     }
 
-    int sampleInitialValue() {
-      return (*_initialDist)(*_randomNumberGeneratorPtr);
+    // the variable is not modified by sampling, the random number generator is passed in by the caller
+    int sampleInitialValue(std::default_random_engine &randomNumberGenerator) {
+      return (*_initialDist)(randomNumberGenerator);
     }
 
-    int sample(std::vector<int> &inputs){
-      int index;
+    int sample(std::vector<int> &inputs, std::default_random_engine &randomNumberGenerator){
+      int index = 0;
       if (_mode == CPT) {
-        std::discrete_distribution<int> &distribution = *(_conditionalProbabilityDistribution[inputs]);
-        index = distribution(*_randomNumberGeneratorPtr);
+        std::discrete_distribution<int> &distribution = _conditionalProbabilityTablePtr->getDistribution(inputs);
+        index = distribution(randomNumberGenerator);
       } else if (_mode == SUM) {
         index = 0;
         for (auto &in: inputs) {
@@ -91,14 +295,14 @@ class TwoStageDynamicBayesianNetworkVariable {
         }
       } else if (_mode == EXPSUM) {
         index = 0;
-        for (int i=0; i<=inputs.size()-1; i++) {
+        for (int i=0; i<=(int)inputs.size()-1; i++) {
           index += std::pow(_expSumBase, i) * inputs[i];
         } 
       } else if (_mode == NOISYEXPSUM) {
         index = 0;
         int v;
-        for (int i=0; i<=inputs.size()-1; i++) {
-          float r = 1.0 * std::experimental::randint(0, 9) / 10;
+        for (int i=0; i<=(int)inputs.size()-1; i++) {
+          float r = 1.0 * std::uniform_int_distribution<int>(0, 9)(randomNumberGenerator) / 10;
           if (r < _noise) {
             v = 1 - inputs[i];
           } else {
@@ -106,18 +310,62 @@ class TwoStageDynamicBayesianNetworkVariable {
           }
           index += std::pow(_expSumBase, i) * v;
         }
+      } else if (_mode == NOISYMAX) {
+        // the first value whose cumulative probability is above r, computed value by value as threads share the variable
+        double r = std::uniform_real_distribution<double>(0.0, 1.0)(randomNumberGenerator);
+        index = 0;
+        while (index <= (int)_cumulativeLeak.size()-2 && getCumulativeNoisyMax(inputs, index) <= r) {
+          index += 1;
+        }
+      } else {
+        index = std::bernoulli_distribution(getProbabilityOfOne(inputs))(randomNumberGenerator);
       }
       
       return index;
     }
 
-    int sampleUniformly() {
-      return std::experimental::randint(0, _numberOfValues-1);
+    int sampleUniformly(std::default_random_engine &randomNumberGenerator) {
+      return std::uniform_int_distribution<int>(0, _numberOfValues-1)(randomNumberGenerator);
+    }
+
+    int getMode() {
+      return _mode;
+    }
+
+    int getExpSumBase() {
+      return _expSumBase;
+    }
+
+    float getNoise() {
+      return _noise;
+    }
+
+    // the shared table of a CPT variable, to tell variables with identical tables apart from the others
+    const ConditionalProbabilityTable *getConditionalProbabilityTable() {
+      return _conditionalProbabilityTablePtr.get();
+    }
+
+    // the distribution of a CPT or parametric variable given the indices of its parents
+    std::vector<double> getConditionalProbabilities(const std::vector<int> &inputs) {
+      if (_mode == CPT) {
+        return _conditionalProbabilityTablePtr->getDistribution(inputs).probabilities();
+      } else if (_mode == NOISYMAX) {
+        std::vector<double> probabilities(_cumulativeLeak.size());
+        for (int v=0; v<=(int)probabilities.size()-1; v++) {
+          probabilities[v] = getCumulativeNoisyMax(inputs, v);
+        }
+        for (int i=probabilities.size()-1; i>=1; i--) {
+          probabilities[i] -= probabilities[i-1];
+        }
+        return probabilities;
+      }
+      double probability = getProbabilityOfOne(inputs);
+      return std::vector<double>{1.0 - probability, probability};
     }
 
     float getValueFromIndex(const int index){
-      if (_listOfValues.size() != 0) {
-        return _listOfValues[index];
+      if (_listOfValuesPtr->size() != 0) {
+        return (*_listOfValuesPtr)[index];
       } else {
         return index;
       }
@@ -135,15 +383,73 @@ class TwoStageDynamicBayesianNetworkVariable {
 
   private:
     std::vector<std::string> _listOfParents;
-    std::vector<float> _listOfValues;
+    std::shared_ptr<const std::vector<float>> _listOfValuesPtr;
     std::unique_ptr<std::discrete_distribution<int>> _initialDist;
     bool _isStateVariable = false;
     int _numberOfValues;
-    std::map<std::vector<int>, std::unique_ptr<std::discrete_distribution<int>>> _conditionalProbabilityDistribution;
+    std::shared_ptr<const ConditionalProbabilityTable> _conditionalProbabilityTablePtr;
     int _expSumBase;
     float _noise;
-    std::default_random_engine *_randomNumberGeneratorPtr;
     int _mode;
+    // parameters of the parametric modes
+    double _bias;
+    std::vector<double> _weights;
+    int _threshold;
+    std::vector<double> _cumulativeLeak;
+    std::vector<std::vector<std::vector<double>>> _cumulativeContributions; // per parent, per index of the parent above 0
+
+    // the probability that a binary parametric variable is 1
+    double getProbabilityOfOne(const std::vector<int> &inputs) {
+      if (_mode == NOISYOR) {
+        double probabilityOfZero = 1.0 - _bias;
+        for (int i=0; i<=(int)inputs.size()-1; i++) {
+          if (inputs[i] != 0) {
+            probabilityOfZero *= 1.0 - _weights[i];
+          }
+        }
+        return 1.0 - probabilityOfZero;
+      } else if (_mode == LOGISTIC) {
+        double logit = _bias;
+        for (int i=0; i<=(int)inputs.size()-1; i++) {
+          logit += _weights[i] * inputs[i];
+        }
+        return 1.0 / (1.0 + std::exp(-logit));
+      } else if (_mode == THRESHOLD) {
+        int numberOfActiveParents = 0;
+        for (auto &in: inputs) {
+          numberOfActiveParents += (in != 0);
+        }
+        return numberOfActiveParents >= _threshold ? _weights[1] : _weights[0];
+      }
+      throw std::logic_error(name + " is not a binary parametric variable.");
+    }
+
+    // the cumulative distribution of a NOISYMAX variable at a value, the product of those of the leak and the contributions of the active parents
+    double getCumulativeNoisyMax(const std::vector<int> &inputs, int value) {
+      double cumulative = _cumulativeLeak[value];
+      for (int i=0; i<=(int)inputs.size()-1; i++) {
+        if (inputs[i] != 0) {
+          cumulative *= _cumulativeContributions[i].at(inputs[i]-1)[value];
+        }
+      }
+      return cumulative;
+    }
+
+    // parameters that are probabilities, NaN included in the values that are refused
+    void checkProbabilities(const std::vector<double> &probabilities, const std::string &parameter) {
+      for (auto &probability: probabilities) {
+        if ((probability >= 0.0 && probability <= 1.0) == false) {
+          throw std::invalid_argument(name + " needs " + parameter + " between 0 and 1.");
+        }
+      }
+    }
+
+    static std::vector<double> toCumulative(const std::vector<double> &probabilities) {
+      std::vector<double> cumulative(probabilities.size());
+      std::partial_sum(probabilities.begin(), probabilities.end(), cumulative.begin());
+      cumulative.back() = 1.0;
+      return cumulative;
+    }
 };
 
 #endif
\ No newline at end of file
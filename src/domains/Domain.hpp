@@ -6,6 +6,12 @@
 #include "dbns/TwoStageDynamicBayesianNetwork.hpp"
 #include "influence/InfluencePredictor.hpp"
 #include <memory>
+#include <random>
+#include <unordered_map>
+#include <array>
+#include <type_traits>
+#include <functional>
+#include <numeric>
 #include <math.h>
 
 // Assumptions & Data types:
@@ -17,14 +23,102 @@
 
 class Domain {
   public:
+    // store of action observation histories, a history is the index of its last node and -1 is the empty history
+    // every distinct history has one node and histories that share a prefix share its nodes, so copying a history is copying an index
+    struct HistoryArena {
+      struct Node {
+        int parent;
+        int value;
+        int length; // the number of actions and observations in the history up to this node
+      };
+      std::vector<Node> nodes;
+      std::unordered_map<uint64_t, int> children; // the node of every parent and value
+      int append(int history, int value) {
+        auto inserted = children.emplace(getKey(history, value), (int)nodes.size());
+        if (inserted.second == true) {
+          nodes.push_back({history, value, history == -1 ? 1 : nodes[history].length + 1});
+        }
+        return inserted.first->second;
+      }
+      void clear() {
+        nodes.clear();
+        children.clear();
+      }
+      // releases the nodes that none of the histories ends in or passes through, the histories are renumbered in place
+      // returns the new index of every old node, -1 for the released ones
+      std::vector<int> retain(const std::vector<int*> &histories) {
+        std::vector<int> renumbering(nodes.size(), -1);
+        for (int *history: histories) {
+          for (int node=*history; node != -1 && renumbering[node] == -1; node=nodes[node].parent) {
+            renumbering[node] = 0;
+          }
+        }
+        // a parent precedes its children, so keeping the order keeps the parents renumbered first
+        std::vector<Node> retainedNodes;
+        for (int node=0; node<=(int)nodes.size()-1; node++) {
+          if (renumbering[node] != -1) {
+            renumbering[node] = retainedNodes.size();
+            int parent = nodes[node].parent;
+            retainedNodes.push_back({parent == -1 ? -1 : renumbering[parent], nodes[node].value, nodes[node].length});
+          }
+        }
+        nodes.swap(retainedNodes);
+        children.clear();
+        for (int node=0; node<=(int)nodes.size()-1; node++) {
+          children.emplace(getKey(nodes[node].parent, nodes[node].value), node);
+        }
+        for (int *history: histories) {
+          if (*history != -1) {
+            *history = renumbering[*history];
+          }
+        }
+        return renumbering;
+      }
+      static uint64_t getKey(int history, int value) {
+        return ((uint64_t)(uint32_t)(history+1) << 32) | (uint32_t)value;
+      }
+      // write the history into an AOH in the format of the atomic agents: AOH[0] is where writing continues
+      void materialize(int history, std::vector<int> &AOH) {
+        AOH[0] = history == -1 ? 1 : nodes[history].length + 1;
+        for (int node=history; node != -1; node=nodes[node].parent) {
+          AOH[nodes[node].length] = nodes[node].value;
+        }
+      }
+    };
+
+    // everything a simulation writes to apart from the state itself, one context per thread
+    // the domain, the DBN and the influence predictors are only read while simulating
+    struct SimulationContext {
+      SimulationContext(): randomNumberGenerator(std::random_device()()) {}
+      SimulationContext(unsigned int seed): randomNumberGenerator(seed) {}
+      std::default_random_engine randomNumberGenerator;
+      // scratch buffers, laid out by the simulator that uses the context in prepareContext
+      std::map<std::string, int> environmentState;
+      std::vector<int*> environmentStatePtrs;
+      std::vector<int> influencePredictorInputs;
+      std::vector<float> influencePredictorState;
+      std::vector<int> agentObservations; // observations of a batch of simulated agents
+      HistoryArena histories; // histories of simulated agents, referenced by the states simulated with this context
+      std::vector<std::vector<int>> agentAOHs; // materialized histories of simulated agents
+      std::vector<int> materializedHistories; // the histories that agentAOHs currently hold
+      std::vector<uint64_t> bitsets; // scratch words of native models of domains
+    };
+
     // single agent simulator for planning agents
     // using templating as different simulators will need states of data types
     template <class State> class SingleAgentSimulator {
       public:
-        SingleAgentSimulator(const std::string &IDOfAgentToControl, Domain *domainPtr): _IDOfAgentToControl(IDOfAgentToControl), _domainPtr(domainPtr) {}
-        virtual void step(State &state, int action, int &observation, float &reward, bool &done) = 0;
-        virtual float rollout(State &initialState, int horizon, int depth, float discountHorizon) = 0;
-        virtual State sampleInitialState() = 0;
+        SingleAgentSimulator(const std::string &IDOfAgentToControl, Domain *domainPtr): _domainPtr(domainPtr), _IDOfAgentToControl(IDOfAgentToControl) {}
+        virtual ~SingleAgentSimulator() {}
+        virtual void step(State &state, int action, int &observation, float &reward, bool &done, SimulationContext &context) = 0;
+        virtual float rollout(State &initialState, int horizon, int depth, float discountHorizon, SimulationContext &context) = 0;
+        virtual State sampleInitialState(SimulationContext &context) = 0;
+        // set up the scratch buffers of a context before it is used with this simulator
+        // states sampled with the context before may refer to storage of the context and are not valid afterwards
+        virtual void prepareContext(SimulationContext &context) {}
+        // release the storage of the context that only other states than the ones collected refer to, the collected states remain valid
+        // collectStates is only called by simulators whose states refer to storage of the context
+        virtual void releaseContext(const std::function<void(std::vector<State*>&)> &collectStates, SimulationContext &context) {}
       protected:
         Domain *_domainPtr;
         std::string _IDOfAgentToControl;
@@ -32,85 +126,179 @@ class Domain {
 
     // the state space of global simulator
     struct SingleAgentGlobalSimulatorState {
-      std::map<std::string, int> environmentState;
-      std::vector<int> AOH; // the AOH of other agents // can also be map of vectors
+      std::vector<int> environmentState; // dense, indexed by the variable indices of the DBN
+      std::vector<int> AOH; // the compact policy states of the agent batches followed by the histories of other agents, packed in one array
     };
 
     // single agent global simulator
-    class SingleAgentGlobalSimulator: public SingleAgentSimulator<SingleAgentGlobalSimulatorState> {
+    class SingleAgentGlobalSimulator final: public SingleAgentSimulator<SingleAgentGlobalSimulatorState> {
       public:
         SingleAgentGlobalSimulator(const std::string &IDOfAgentToControl, Domain *domainPtr, const YAML::Node &fullAgentParameters): SingleAgentSimulator<SingleAgentGlobalSimulatorState>(IDOfAgentToControl, domainPtr) {
+          TwoStageDynamicBayesianNetwork *DBNPtr = _domainPtr->_DBNPtr;
           // build up the agent simulators
-          int counter = 0;
+          std::map<std::string, std::vector<std::string>> agentsPerPolicy;
+          std::vector<std::string> agentsWithAOH;
           for (YAML::const_iterator it = fullAgentParameters.begin(); it != fullAgentParameters.end(); it++) {
             std::string agentID = it->first.as<std::string>();
             if (agentID != _IDOfAgentToControl) {
               std::string agentType = it->second["Type"].as<std::string>();
               agentSimulators[agentID] = std::unique_ptr<AtomicAgentSimulator>(_domainPtr->makeAtomicAgentSimulator(agentID, agentType));
-              agentStateIndices[agentID] = counter;
-              counter +=  1 + 2 * (_domainPtr->_numberOfStepsToPlan);
+              // agents with a compact policy state are batched by policy and do not keep their AOH
+              if (agentSimulators[agentID]->getSizeOfCompactState() >= 0) {
+                std::string policyKey = agentSimulators[agentID]->getPolicyKey();
+                agentsPerPolicy[policyKey.empty() ? "#" + agentID : policyKey].push_back(agentID);
+              } else {
+                agentsWithAOH.push_back(agentID);
+              }
+            }
+          }
+          int counter = 0;
+          int maximumBatchSize = 0;
+          for (auto &[policyKey, agentIDs]: agentsPerPolicy) {
+            AgentBatch batch;
+            batch.simulatorPtr = agentSimulators.at(agentIDs[0]).get();
+            batch.stateIndex = counter;
+            batch.numberOfAgents = agentIDs.size();
+            for (auto &agentID: agentIDs) {
+              batch.actionIndices.push_back(DBNPtr->getIndexOfVariable("a"+agentID));
+              batch.observationIndices.push_back(DBNPtr->getIndexOfVariable("o"+agentID));
             }
+            counter += batch.simulatorPtr->getSizeOfCompactState() * batch.numberOfAgents;
+            maximumBatchSize = std::max(maximumBatchSize, batch.numberOfAgents);
+            _agentBatches.push_back(batch);
+            VLOG(1) << "Policy " << policyKey << " is simulated for agents " << PrintUtils::vectorToTupleString(agentIDs) << " in one batch.";
+          }
+          // agents without a compact policy state keep their AOH in the history arena of the context, the state holds the last node
+          for (auto &agentID: agentsWithAOH) {
+            _agentsWithAOH.push_back({agentSimulators.at(agentID).get(), counter, DBNPtr->getIndexOfVariable("a"+agentID), DBNPtr->getIndexOfVariable("o"+agentID)});
+            counter += 1;
           }
           _sizeOfAOH = counter;
-          VLOG(1) << _domainPtr->_domainName << " single agent global simulator has been built.";
+          _maximumBatchSize = maximumBatchSize;
+          _actionIndex = DBNPtr->getIndexOfVariable("a"+_IDOfAgentToControl);
+          _observationIndex = DBNPtr->getIndexOfVariable("o"+_IDOfAgentToControl);
+          _rewardIndex = DBNPtr->getIndexOfVariable("r"+_IDOfAgentToControl);
+          VLOG(1) << _domainPtr->_domainName << " single agent global simulator has been built, " << _agentBatches.size() << " policy batches and " << _agentsWithAOH.size() << " agents with AOHs.";
+        }
+
+        // states sampled before with this context can not be simulated afterwards, as their histories are released
+        void prepareContext(SimulationContext &context) {
+          context.agentObservations.assign(_maximumBatchSize, 0);
+          context.histories.clear();
+          context.agentAOHs.assign(_agentsWithAOH.size(), std::vector<int>(1 + 2 * (_domainPtr->_numberOfStepsToPlan)));
+          context.materializedHistories.assign(_agentsWithAOH.size(), -2); // -2 means nothing has been materialized
+        }
+
+        // the histories of other states are released and the histories of the states are renumbered
+        void releaseContext(const std::function<void(std::vector<SingleAgentGlobalSimulatorState*>&)> &collectStates, SimulationContext &context) {
+          if (_agentsWithAOH.empty() == true) {
+            return;
+          }
+          std::vector<SingleAgentGlobalSimulatorState*> states;
+          collectStates(states);
+          std::vector<int*> histories;
+          histories.reserve(states.size() * _agentsWithAOH.size());
+          for (auto statePtr: states) {
+            for (auto &agent: _agentsWithAOH) {
+              histories.push_back(&statePtr->AOH[agent.stateIndex]);
+            }
+          }
+          std::vector<int> renumbering = context.histories.retain(histories);
+          for (int &history: context.materializedHistories) {
+            if (history >= 0) {
+              history = renumbering[history] == -1 ? -2 : renumbering[history];
+            }
+          }
+          VLOG(3) << context.histories.nodes.size() << " nodes of histories of other agents are kept.";
         }
 
-        void updateState(SingleAgentGlobalSimulatorState &state) {
+        void updateState(SingleAgentGlobalSimulatorState &state, SimulationContext &context) {
           // send observations to the corresponding agents
-          for (auto &[agentID, startIndex]: agentStateIndices) {
-            int agentObs = _domainPtr->_DBNPtr->getValueOfVariableFromIndex("o"+agentID, state.environmentState);
-            agentSimulators[agentID]->observe(state.AOH.begin()+agentStateIndices[agentID], agentObs);
+          TwoStageDynamicBayesianNetwork *DBNPtr = _domainPtr->_DBNPtr;
+          for (auto &batch: _agentBatches) {
+            for (int i=0; i<=batch.numberOfAgents-1; i++) {
+              int observationIndex = batch.observationIndices[i];
+              context.agentObservations[i] = DBNPtr->getVariable(observationIndex)->getValueFromIndex(state.environmentState[observationIndex]);
+            }
+            batch.simulatorPtr->observeCompactBatch(state.AOH.data()+batch.stateIndex, batch.numberOfAgents, context.agentObservations.data());
+          }
+          for (int k=0; k<=(int)_agentsWithAOH.size()-1; k++) {
+            AgentWithAOH &agent = _agentsWithAOH[k];
+            int agentObs = DBNPtr->getVariable(agent.observationIndex)->getValueFromIndex(state.environmentState[agent.observationIndex]);
+            int &history = state.AOH[agent.stateIndex];
+            // keep the materialized history in sync when it is the one being extended
+            bool materialized = (context.materializedHistories[k] == history);
+            history = context.histories.append(history, agentObs);
+            if (materialized == true) {
+              agent.simulatorPtr->observe(context.agentAOHs[k].begin(), agentObs);
+              context.materializedHistories[k] = history;
+            }
           }
         }
 
-        void step(SingleAgentGlobalSimulatorState &state, int action, int &observation, float &reward, bool &done) {
-          // simulate actions of other agents
-          for (auto &[agentID, agentSimulator]: agentSimulators) {
-            int simulatedAction =  agentSimulator->step(state.AOH.begin()+agentStateIndices[agentID]);
-            VLOG(4) << "Agent " << agentID << " is simulated to take action " << std::to_string(simulatedAction) << ".";
-            state.environmentState["a"+agentID] = simulatedAction;
+        // simulate actions of other agents, written into their action slots of the environment state
+        void stepAgents(SingleAgentGlobalSimulatorState &state, SimulationContext &context) {
+          for (auto &batch: _agentBatches) {
+            batch.simulatorPtr->stepCompactBatch(state.AOH.data()+batch.stateIndex, batch.numberOfAgents, state.environmentState.data(), batch.actionIndices.data());
+          }
+          for (int k=0; k<=(int)_agentsWithAOH.size()-1; k++) {
+            AgentWithAOH &agent = _agentsWithAOH[k];
+            int &history = state.AOH[agent.stateIndex];
+            std::vector<int> &AOH = context.agentAOHs[k];
+            // only histories that branched off from the materialized one are rebuilt from the arena
+            if (context.materializedHistories[k] != history) {
+              context.histories.materialize(history, AOH);
+            }
+            int action = agent.simulatorPtr->step(AOH.begin());
+            history = context.histories.append(history, action);
+            context.materializedHistories[k] = history;
+            state.environmentState[agent.actionIndex] = action;
           }
-          state.environmentState["a"+_IDOfAgentToControl] = action;
+        }
+
+        void step(SingleAgentGlobalSimulatorState &state, int action, int &observation, float &reward, bool &done, SimulationContext &context) {
+          stepAgents(state, context);
+          state.environmentState[_actionIndex] = action;
           VLOG(4) << "Finished sampling actions of other agents.";
-          _domainPtr->_DBNPtr->step(state.environmentState, "full");
+          _domainPtr->stepGlobal(state.environmentState, context);
           VLOG(4) << "Finished one step sampling in the DBN.";
-          observation = _domainPtr->_DBNPtr->getValueOfVariableFromIndex("o"+_IDOfAgentToControl, state.environmentState);
-          reward = _domainPtr->_DBNPtr->getValueOfVariableFromIndex("r"+_IDOfAgentToControl, state.environmentState);
-          this->updateState(state);
+          observation = _domainPtr->_DBNPtr->getVariable(_observationIndex)->getValueFromIndex(state.environmentState[_observationIndex]);
+          reward = _domainPtr->_DBNPtr->getVariable(_rewardIndex)->getValueFromIndex(state.environmentState[_rewardIndex]);
+          this->updateState(state, context);
           done = false;
           VLOG(4) << "Finished one step simulation in the global simulator.";
         }
-        SingleAgentGlobalSimulatorState sampleInitialState() {
+        SingleAgentGlobalSimulatorState sampleInitialState(SimulationContext &context) {
           SingleAgentGlobalSimulatorState sampledState;
-          sampledState.environmentState = _domainPtr->sampleInitialState();
+          sampledState.environmentState = _domainPtr->_DBNPtr->toDenseState(_domainPtr->sampleInitialState(context.randomNumberGenerator));
           sampledState.AOH.resize(_sizeOfAOH);
-          for (auto &[agentID, startIndex]: agentStateIndices) {
-            sampledState.AOH[startIndex] = 1; // 1 means writing starts from index 1
+          for (auto &batch: _agentBatches) {
+            batch.simulatorPtr->resetCompactStates(sampledState.AOH.data()+batch.stateIndex, batch.numberOfAgents);
+          }
+          for (auto &agent: _agentsWithAOH) {
+            sampledState.AOH[agent.stateIndex] = -1; // the empty history
           }
           return sampledState;
         }
-        float rollout(SingleAgentGlobalSimulatorState &state, int horizon, int depth, float discountHorizon) {
+        float rollout(SingleAgentGlobalSimulatorState &state, int horizon, int depth, float discountHorizon, SimulationContext &context) {
           auto begin = std::clock();
           float undiscounted_return = 0.0;
           float factor = 1.0;
           float tFactor = std::pow(_domainPtr->_discountFactor, depth);
+          TwoStageDynamicBayesianNetworkVariable *rewardVariablePtr = _domainPtr->_DBNPtr->getVariable(_rewardIndex);
           for (int step=0; step<=horizon-1; step++) {
             if (tFactor < discountHorizon) {
                
               break;
             }
             // simulate actions of agents
-            for (auto &[agentID, agentSimulator]: agentSimulators) {
-              int simulatedAction =  agentSimulator->step(state.AOH.begin()+agentStateIndices[agentID]);
-              VLOG(4) << "Agent " << agentID << " is simulated to take action " << std::to_string(simulatedAction) << ".";
-              state.environmentState["a"+agentID] = simulatedAction;
-            }
-            state.environmentState["a"+_IDOfAgentToControl] = std::experimental::randint(0,_domainPtr->_numberOfActions[_IDOfAgentToControl]-1);
+            stepAgents(state, context);
+            state.environmentState[_actionIndex] = RandomUtils::randint(0,_domainPtr->_numberOfActions.at(_IDOfAgentToControl)-1);
             // one step simulation in the DBN
-            _domainPtr->_DBNPtr->step(state.environmentState, "full");
-            undiscounted_return += factor * _domainPtr->_DBNPtr->getValueOfVariableFromIndex("r"+_IDOfAgentToControl, state.environmentState);
+            _domainPtr->stepGlobal(state.environmentState, context);
+            undiscounted_return += factor * rewardVariablePtr->getValueFromIndex(state.environmentState[_rewardIndex]);
             if (step != horizon-1) {
-              this->updateState(state);
+              this->updateState(state, context);
             }
             factor *= _domainPtr->_discountFactor;
             depth += 1;
@@ -120,9 +308,28 @@ class Domain {
           return undiscounted_return;
         }
       private:
+        // agents with the same policy, simulated by the agent simulator of the first of them
+        struct AgentBatch {
+          AtomicAgentSimulator *simulatorPtr;
+          int stateIndex; // where the compact states of the batch start
+          int numberOfAgents;
+          std::vector<int> actionIndices;
+          std::vector<int> observationIndices;
+        };
+        struct AgentWithAOH {
+          AtomicAgentSimulator *simulatorPtr;
+          int stateIndex; // where the history of the agent is stored
+          int actionIndex;
+          int observationIndex;
+        };
         std::map<std::string, std::unique_ptr<AtomicAgentSimulator>> agentSimulators;
         int _sizeOfAOH = 0;
-        std::map<std::string, int> agentStateIndices;
+        int _maximumBatchSize = 0;
+        std::vector<AgentBatch> _agentBatches;
+        std::vector<AgentWithAOH> _agentsWithAOH;
+        int _actionIndex;
+        int _observationIndex;
+        int _rewardIndex;
     };
 
     // single agnet influence augmented local simulator
@@ -135,6 +342,12 @@ class Domain {
           std::string influencePredictorType = simulatorParameters["InfluencePredictor"]["Type"].as<std::string>();
           if (influencePredictorType == "Random") {
             _influencePredictorPtr = std::unique_ptr<InfluencePredictor>(new RandomInfluencePredictor(this->_domainPtr->_DBNPtr, _dSeparationSetPerStep, _sourceFactors));
+          } else if (influencePredictorType == "Tabular") {
+            const YAML::Node &predictorParameters = simulatorParameters["InfluencePredictor"];
+            std::string modelPath = predictorParameters["modelPath"].as<std::string>();
+            std::string dataPath = predictorParameters["dataPath"].IsDefined() ? predictorParameters["dataPath"].as<std::string>() : std::filesystem::path(modelPath).parent_path().string();
+            float smoothing = predictorParameters["smoothing"].IsDefined() ? predictorParameters["smoothing"].as<float>() : 1.0;
+            _influencePredictorPtr = std::unique_ptr<InfluencePredictor>(new TabularInfluencePredictor(this->_domainPtr->_DBNPtr, _dSeparationSetPerStep, _sourceFactors, modelPath, dataPath, predictorParameters["historyLength"].as<int>(), smoothing));
           } else {
             std::string modelPath = simulatorParameters["InfluencePredictor"]["modelPath"].as<std::string>();
             int numberOfHiddenStates = simulatorParameters["InfluencePredictor"]["numberOfHiddenStates"].as<int>();
@@ -143,7 +356,8 @@ class Domain {
             } else if (influencePredictorType == "GRU") {
               _influencePredictorPtr = std::unique_ptr<InfluencePredictor>(new GRUInfluencePredictor(this->_domainPtr->_DBNPtr, _dSeparationSetPerStep, _sourceFactors, modelPath, numberOfHiddenStates, simulatorParameters["InfluencePredictor"]["fast"].as<bool>()));
             } else {
-              LOG(FATAL) << "Influence predictor type " << influencePredictorType << " is not supported.";
+              std::string message = "Influence predictor type " + influencePredictorType + " is not supported.";
+              throw std::invalid_argument(message);
             }
           }  
         }
@@ -157,12 +371,10 @@ class Domain {
         std::vector<std::string> _destinationFactors;
         std::vector<std::string> _dSeparationSetPerStep;
 
-        void sampleEnvironmentState(std::map<std::string, int> &environmentState) {
-          // sample a full environment state
-          std::map<std::string, int> fullSampledState = this->_domainPtr->sampleInitialState();
-          // take the local states out
+        void sampleEnvironmentState(std::map<std::string, int> &environmentState, std::default_random_engine &randomNumberGenerator) {
+          // state variables are sampled independently initially, so only the local states are sampled rather than a full environment state
           for (auto &varName: _localStates) {
-            environmentState[varName] = fullSampledState[varName];
+            environmentState[varName] = this->_domainPtr->_DBNPtr->getVariable(varName)->sampleInitialValue(randomNumberGenerator);
           }
         }
     };
@@ -173,7 +385,7 @@ class Domain {
     };
 
     // singlet agent sequential influence augmented local simulator
-    class SingleAgentSequentialInfluenceAugmentedSimulator: public SingleAgentInfluenceAugmentedSimulator<SingleAgentSequentialInfluenceAugmentedSimulatorState> {
+    class SingleAgentSequentialInfluenceAugmentedSimulator final: public SingleAgentInfluenceAugmentedSimulator<SingleAgentSequentialInfluenceAugmentedSimulatorState> {
       public:
         SingleAgentSequentialInfluenceAugmentedSimulator(const std::string &IDOfAgentToControl, Domain *domainPtr, const YAML::Node &simulatorParameters): SingleAgentInfluenceAugmentedSimulator<SingleAgentSequentialInfluenceAugmentedSimulatorState>(IDOfAgentToControl, domainPtr, simulatorParameters) {
           VLOG(1) << "Single agent sequential influence augmented simulator has been built.";
@@ -187,17 +399,17 @@ class Domain {
           state.influencePredictorInputs.push_back(action);
         }
 
-        void step(SingleAgentSequentialInfluenceAugmentedSimulatorState &state, int action, int &observation, float &reward, bool &done) {
+        void step(SingleAgentSequentialInfluenceAugmentedSimulatorState &state, int action, int &observation, float &reward, bool &done, SimulationContext &context) {
           state.environmentState["a"+this->_IDOfAgentToControl] = action;
-          _influencePredictorPtr->sample(state.influencePredictorInputs, state.environmentState);
-          this->_domainPtr->_DBNPtr->step(state.environmentState, "local");
+          _influencePredictorPtr->sample(state.influencePredictorInputs, state.environmentState, context.randomNumberGenerator);
+          this->_domainPtr->stepLocal(this->_IDOfAgentToControl, state.environmentState, context);
           reward = this->_domainPtr->_DBNPtr->getValueOfVariableFromIndex("r"+this->_IDOfAgentToControl, state.environmentState);
           observation = this->_domainPtr->_DBNPtr->getValueOfVariableFromIndex("o"+this->_IDOfAgentToControl, state.environmentState);
           this->updateState(state, action);
           done =false;
         }
 
-        float rollout(SingleAgentSequentialInfluenceAugmentedSimulatorState &state, int horizon, int depth, float discountHorizon) {
+        float rollout(SingleAgentSequentialInfluenceAugmentedSimulatorState &state, int horizon, int depth, float discountHorizon, SimulationContext &context) {
           if (horizon <= 0) return 0.0;
           float undiscounted_return = 0.0;
           float factor = 1.0;
@@ -209,13 +421,12 @@ class Domain {
               break;
             }
 
-            int action = std::experimental::randint(0,_domainPtr->_numberOfActions[_IDOfAgentToControl]-1);
-            _influencePredictorPtr->sample(state.influencePredictorInputs, state.environmentState);
+            int action = RandomUtils::randint(0,_domainPtr->_numberOfActions.at(_IDOfAgentToControl)-1);
+            _influencePredictorPtr->sample(state.influencePredictorInputs, state.environmentState, context.randomNumberGenerator);
             state.environmentState["a"+_IDOfAgentToControl] = action;
-            _domainPtr->_DBNPtr->step(state.environmentState, "local");
+            _domainPtr->stepLocal(_IDOfAgentToControl, state.environmentState, context);
             undiscounted_return += factor * _domainPtr->_DBNPtr->getValueOfVariableFromIndex("r"+_IDOfAgentToControl, state.environmentState);
             if (step != horizon-1) {
-              int observation = _domainPtr->_DBNPtr->getValueOfVariableFromIndex("o"+_IDOfAgentToControl, state.environmentState);
               this->updateState(state, action);
             }
 
@@ -226,9 +437,9 @@ class Domain {
           return undiscounted_return;
         }
 
-        SingleAgentSequentialInfluenceAugmentedSimulatorState sampleInitialState() {
+        SingleAgentSequentialInfluenceAugmentedSimulatorState sampleInitialState(SimulationContext &context) {
           SingleAgentSequentialInfluenceAugmentedSimulatorState sampledState;
-          this->sampleEnvironmentState(sampledState.environmentState);
+          this->sampleEnvironmentState(sampledState.environmentState, context.randomNumberGenerator);
           return sampledState;
         }
     };
@@ -240,7 +451,7 @@ class Domain {
       std::vector<float> influencePredictorState; // the hidden state of the influence predictor
     };
 
-    class SingleAgentRecurrentInfluenceAugmentedSimulator: public SingleAgentInfluenceAugmentedSimulator<SingleAgentRecurrentInfluenceAugmentedSimulatorState> {
+    class SingleAgentRecurrentInfluenceAugmentedSimulator final: public SingleAgentInfluenceAugmentedSimulator<SingleAgentRecurrentInfluenceAugmentedSimulatorState> {
       public:
         SingleAgentRecurrentInfluenceAugmentedSimulator(const std::string &IDOfAgentToControl, Domain *domainPtr, const YAML::Node &simulatorParameters): SingleAgentInfluenceAugmentedSimulator<SingleAgentRecurrentInfluenceAugmentedSimulatorState>(IDOfAgentToControl, domainPtr, simulatorParameters) {
           VLOG(1) << "Single agent recurrent influence augmented simulator has been built.";
@@ -258,17 +469,17 @@ class Domain {
           state.initial = false;
         }
 
-        void step(SingleAgentRecurrentInfluenceAugmentedSimulatorState &state, int action, int &observation, float &reward, bool &done) {
+        void step(SingleAgentRecurrentInfluenceAugmentedSimulatorState &state, int action, int &observation, float &reward, bool &done, SimulationContext &context) {
           state.environmentState["a"+this->_IDOfAgentToControl] = action;
-          _influencePredictorPtr->oneStepSample(state.influencePredictorState, state.influencePredictorInputs, state.initial, state.environmentState);
-          this->_domainPtr->_DBNPtr->step(state.environmentState, "local");
+          _influencePredictorPtr->oneStepSample(state.influencePredictorState, state.influencePredictorInputs, state.initial, state.environmentState, context.randomNumberGenerator);
+          this->_domainPtr->stepLocal(this->_IDOfAgentToControl, state.environmentState, context);
           reward = this->_domainPtr->_DBNPtr->getValueOfVariableFromIndex("r"+this->_IDOfAgentToControl, state.environmentState);
           observation = this->_domainPtr->_DBNPtr->getValueOfVariableFromIndex("o"+this->_IDOfAgentToControl, state.environmentState);
           this->updateState(state, action);
           done =false;
         }
 
-        float rollout(SingleAgentRecurrentInfluenceAugmentedSimulatorState &state, int horizon, int depth, float discountHorizon) {
+        float rollout(SingleAgentRecurrentInfluenceAugmentedSimulatorState &state, int horizon, int depth, float discountHorizon, SimulationContext &context) {
           float undiscounted_return = 0.0;
           float factor = 1.0;
           float tFactor = std::pow(_domainPtr->_discountFactor, depth);
@@ -279,13 +490,12 @@ class Domain {
               break;
             }
 
-            int action = std::experimental::randint(0, _domainPtr->_numberOfActions[_IDOfAgentToControl]-1);
-            _influencePredictorPtr->oneStepSample(state.influencePredictorState, state.influencePredictorInputs, state.initial, state.environmentState);
+            int action = RandomUtils::randint(0, _domainPtr->_numberOfActions.at(_IDOfAgentToControl)-1);
+            _influencePredictorPtr->oneStepSample(state.influencePredictorState, state.influencePredictorInputs, state.initial, state.environmentState, context.randomNumberGenerator);
             state.environmentState["a"+_IDOfAgentToControl] = action;
-            _domainPtr->_DBNPtr->step(state.environmentState, "local");
+            _domainPtr->stepLocal(_IDOfAgentToControl, state.environmentState, context);
             undiscounted_return += factor * _domainPtr->_DBNPtr->getValueOfVariableFromIndex("r"+_IDOfAgentToControl, state.environmentState);
             if (step != horizon-1) {
-              int observation = _domainPtr->_DBNPtr->getValueOfVariableFromIndex("o"+_IDOfAgentToControl, state.environmentState);
               this->updateState(state, action);
             }
             depth += 1;
@@ -296,11 +506,11 @@ class Domain {
         }
 
         // this should work as our local state space only includes the fire levels of the houses
-        SingleAgentRecurrentInfluenceAugmentedSimulatorState sampleInitialState() {
+        SingleAgentRecurrentInfluenceAugmentedSimulatorState sampleInitialState(SimulationContext &context) {
           SingleAgentRecurrentInfluenceAugmentedSimulatorState sampledState;
           sampledState.initial = true;
           sampledState.influencePredictorState = _influencePredictorPtr->getInitialState();
-          this->sampleEnvironmentState(sampledState.environmentState);
+          this->sampleEnvironmentState(sampledState.environmentState, context.randomNumberGenerator);
           // placeholders
           for (int i=0; i<=(int)_dSeparationSetPerStep.size()-1; i++){
             sampledState.influencePredictorInputs.push_back(0);
@@ -309,11 +519,155 @@ class Domain {
         }
     };
 
+    // recurrent influence augmented local simulator state with inline storage of fixed capacity
+    // H: capacity of the hidden state, L: capacity of the local states, so copying a particle is a plain memcpy
+    template <int H, int L> struct SingleAgentFixedRecurrentInfluenceAugmentedSimulatorState {
+      std::array<int, L> localStates; // in the order of the local states of the local model
+      std::array<int, L+1> influencePredictorInputs; // local states and action of the last stage
+      std::array<float, H> influencePredictorState; // the hidden state of the influence predictor
+      bool initial; // whether this is an initial state
+    };
+
+    // the recurrent influence augmented local simulator on fixed capacity states
+    // the DBN and the influence predictor work on the scratch buffers of the simulation context
+    template <int H, int L> class SingleAgentFixedRecurrentInfluenceAugmentedSimulator final: public SingleAgentInfluenceAugmentedSimulator<SingleAgentFixedRecurrentInfluenceAugmentedSimulatorState<H, L>> {
+      public:
+        typedef SingleAgentFixedRecurrentInfluenceAugmentedSimulatorState<H, L> State;
+        static_assert(std::is_trivially_copyable<State>::value, "fixed capacity states should be trivially copyable.");
+
+        SingleAgentFixedRecurrentInfluenceAugmentedSimulator(const std::string &IDOfAgentToControl, Domain *domainPtr, const YAML::Node &simulatorParameters): SingleAgentInfluenceAugmentedSimulator<State>(IDOfAgentToControl, domainPtr, simulatorParameters) {
+          _numberOfLocalStates = this->_localStates.size();
+          _numberOfHiddenStates = this->_influencePredictorPtr->getInitialState().size();
+          if (_numberOfLocalStates > L || _numberOfHiddenStates > H) {
+            std::string message = "Local model with " + std::to_string(_numberOfLocalStates) + " local states and hidden state of size " + std::to_string(_numberOfHiddenStates) + " exceeds the capacity of the fixed state.";
+            throw std::invalid_argument(message);
+          }
+          std::string observationName = "o"+IDOfAgentToControl;
+          std::string rewardName = "r"+IDOfAgentToControl;
+          _observationVariablePtr = this->_domainPtr->_DBNPtr->getVariable(observationName);
+          _rewardVariablePtr = this->_domainPtr->_DBNPtr->getVariable(rewardName);
+          VLOG(1) << "Single agent fixed recurrent influence augmented simulator with capacity (" << H << ", " << L << ") has been built.";
+        }
+
+        // the entries of the scratch environment state are created once and then only overwritten
+        // pointers: the local states in order, then action, observation and reward
+        void prepareContext(SimulationContext &context) {
+          std::map<std::string, int> &environmentState = context.environmentState;
+          environmentState.clear();
+          context.environmentStatePtrs.clear();
+          for (auto &varName: this->_localStates) {
+            context.environmentStatePtrs.push_back(&environmentState[varName]);
+          }
+          context.environmentStatePtrs.push_back(&environmentState["a"+this->_IDOfAgentToControl]);
+          context.environmentStatePtrs.push_back(&environmentState["o"+this->_IDOfAgentToControl]);
+          context.environmentStatePtrs.push_back(&environmentState["r"+this->_IDOfAgentToControl]);
+          context.influencePredictorInputs.assign(_numberOfLocalStates+1, 0);
+          context.influencePredictorState.assign(_numberOfHiddenStates, 0.0);
+        }
+
+        void step(State &state, int action, int &observation, float &reward, bool &done, SimulationContext &context) {
+          loadEnvironmentState(state, context);
+          *context.environmentStatePtrs[_numberOfLocalStates] = action;
+          oneStepSample(state, context);
+          this->_domainPtr->stepLocal(this->_IDOfAgentToControl, context.environmentState, context);
+          reward = _rewardVariablePtr->getValueFromIndex(*context.environmentStatePtrs[_numberOfLocalStates+2]);
+          observation = _observationVariablePtr->getValueFromIndex(*context.environmentStatePtrs[_numberOfLocalStates+1]);
+          storeEnvironmentState(state, context);
+          this->updateState(state, action);
+          done = false;
+        }
+
+        float rollout(State &state, int horizon, int depth, float discountHorizon, SimulationContext &context) {
+          float undiscounted_return = 0.0;
+          float factor = 1.0;
+          float tFactor = std::pow(this->_domainPtr->_discountFactor, depth);
+          loadEnvironmentState(state, context);
+          for (int step=0; step<=horizon-1; step++){
+
+            if (tFactor < discountHorizon) {
+              VLOG(4) << "rollout terminated because discount horizon reached.";
+              break;
+            }
+
+            int action = RandomUtils::randint(0, this->_domainPtr->_numberOfActions.at(this->_IDOfAgentToControl)-1);
+            oneStepSample(state, context);
+            *context.environmentStatePtrs[_numberOfLocalStates] = action;
+            this->_domainPtr->stepLocal(this->_IDOfAgentToControl, context.environmentState, context);
+            undiscounted_return += factor * _rewardVariablePtr->getValueFromIndex(*context.environmentStatePtrs[_numberOfLocalStates+2]);
+            if (step != horizon-1) {
+              storeEnvironmentState(state, context);
+              this->updateState(state, action);
+            }
+            depth += 1;
+            tFactor *= this->_domainPtr->_discountFactor;
+            factor *= this->_domainPtr->_discountFactor;
+          }
+          return undiscounted_return;
+        }
+
+        State sampleInitialState(SimulationContext &context) {
+          State sampledState;
+          sampledState.initial = true;
+          sampledState.influencePredictorState.fill(0.0);
+          sampledState.influencePredictorInputs.fill(0);
+          sampledState.localStates.fill(0);
+          // states of predictors without a hidden state (H == 0) have no storage for it
+          if constexpr (H > 0) {
+            std::vector<float> initialHiddenState = this->_influencePredictorPtr->getInitialState();
+            std::copy(initialHiddenState.begin(), initialHiddenState.end(), sampledState.influencePredictorState.begin());
+          }
+          std::map<std::string, int> environmentState;
+          this->sampleEnvironmentState(environmentState, context.randomNumberGenerator);
+          for (int i=0; i<=_numberOfLocalStates-1; i++) {
+            sampledState.localStates[i] = environmentState[this->_localStates[i]];
+          }
+          return sampledState;
+        }
+
+      private:
+        int _numberOfLocalStates;
+        int _numberOfHiddenStates;
+        TwoStageDynamicBayesianNetworkVariable *_observationVariablePtr;
+        TwoStageDynamicBayesianNetworkVariable *_rewardVariablePtr;
+
+        void loadEnvironmentState(State &state, SimulationContext &context) {
+          for (int i=0; i<=_numberOfLocalStates-1; i++) {
+            *context.environmentStatePtrs[i] = state.localStates[i];
+          }
+        }
+
+        void storeEnvironmentState(State &state, SimulationContext &context) {
+          for (int i=0; i<=_numberOfLocalStates-1; i++) {
+            state.localStates[i] = *context.environmentStatePtrs[i];
+          }
+        }
+
+        // sample the influence sources into the scratch environment state and advance the hidden state
+        void oneStepSample(State &state, SimulationContext &context) {
+          if constexpr (H > 0) {
+            std::copy(state.influencePredictorState.begin(), state.influencePredictorState.begin()+_numberOfHiddenStates, context.influencePredictorState.begin());
+          }
+          std::copy(state.influencePredictorInputs.begin(), state.influencePredictorInputs.begin()+_numberOfLocalStates+1, context.influencePredictorInputs.begin());
+          this->_influencePredictorPtr->oneStepSample(context.influencePredictorState, context.influencePredictorInputs, state.initial, context.environmentState, context.randomNumberGenerator);
+          if constexpr (H > 0) {
+            std::copy(context.influencePredictorState.begin(), context.influencePredictorState.end(), state.influencePredictorState.begin());
+          }
+        }
+
+        void updateState(State &state, int action) {
+          for (int i=0; i<=_numberOfLocalStates-1; i++) {
+            state.influencePredictorInputs[i] = state.localStates[i];
+          }
+          state.influencePredictorInputs[_numberOfLocalStates] = action;
+          state.initial = false;
+        }
+    };
+
     class Environment {
       public:
-        Environment(Domain &domain): _domain(domain){};
+        Environment(Domain &domain): _domain(domain), _randomNumberGenerator(std::random_device()()) {};
         virtual void step(std::map<std::string, int> &action, std::map<std::string, int> &observation, std::map<std::string, float> &reward, bool &done) {
-          _domain.step(state, action, observation, reward, done, "full");
+          _domain.step(state, action, observation, reward, done, "full", _randomNumberGenerator);
           std::map<std::string, int> newState = state;
           state.clear();
           for (auto &[key, val]: newState) {
@@ -324,7 +678,11 @@ class Domain {
         }
         virtual void reset() {
           VLOG(1) << "Resetting environment.";
-          state = _domain.sampleInitialState();
+          state = _domain.sampleInitialState(_randomNumberGenerator);
+        }
+        // environments own their random number generator, so environments of the same domain can step in parallel
+        void seed(unsigned int seed) {
+          _randomNumberGenerator.seed(seed);
         }
         virtual ~Environment(){};
         virtual std::map<std::string, int> &getState() {
@@ -333,6 +691,7 @@ class Domain {
       private:
         Domain &_domain;
         std::map<std::string, int> state;
+        std::default_random_engine _randomNumberGenerator;
     };
 
     Domain(const YAML::Node &parameters){
@@ -348,9 +707,13 @@ class Domain {
       }
       VLOG(1) << "list of agents: " + PrintUtils::vectorToString(_listOfAgentIDs);
 
-      // building the DBN
-      std::string yamlFilePath = parameters[_domainName]["2SDBNYamlFilePath"].as<std::string>();
-      _DBNPtr = new TwoStageDynamicBayesianNetwork(yamlFilePath);
+      // building the DBN, from a network generated in memory or from a yaml file
+      if (parameters[_domainName]["network"].IsDefined()) {
+        _DBNPtr = new TwoStageDynamicBayesianNetwork(parameters[_domainName]["network"]);
+      } else {
+        std::string yamlFilePath = parameters[_domainName]["2SDBNYamlFilePath"].as<std::string>();
+        _DBNPtr = new TwoStageDynamicBayesianNetwork(yamlFilePath);
+      }
       _DBNPtr->computeFullSamplingOrder(); 
 
       _numberOfActions = _DBNPtr->getNumberOfActions();
@@ -362,6 +725,18 @@ class Domain {
       LOG(INFO) << _domainName << " has been initialized";
     }
 
+    // the parameters with the network of the domain generated from its "generate" section, if it has one and no network yet
+    // domains pass these to the constructor of Domain, so that the network is generated before the DBN is built
+    static YAML::Node withGeneratedNetwork(const YAML::Node &parameters, YAML::Node (*generateNetwork)(const YAML::Node &)) {
+      std::string domainName = parameters["General"]["domain"].as<std::string>();
+      if (parameters[domainName]["generate"].IsDefined() == false || parameters[domainName]["network"].IsDefined() == true) {
+        return parameters;
+      }
+      YAML::Node parametersWithNetwork = YAML::Clone(parameters);
+      parametersWithNetwork[domainName]["network"] = generateNetwork(parameters[domainName]);
+      return parametersWithNetwork;
+    }
+
     virtual AtomicAgentSimulator *makeAtomicAgentSimulator(const std::string &agentID, const std::string &agentType) = 0;
 
     virtual AtomicAgent *makeAtomicAgent(const std::string &agentID, const std::string &agentType) = 0;
@@ -385,6 +760,28 @@ class Domain {
       return _DBNPtr;
     }
 
+    // one step of the full model on a dense state, indexed by the variable indices of the DBN
+    // domains with a native model of their dynamics override this and the local step to bypass the generic DBN
+    virtual void stepGlobal(std::vector<int> &environmentState, SimulationContext &context) {
+      _DBNPtr->step(environmentState, "full", context.randomNumberGenerator);
+    }
+
+    // one step of the local model of an agent
+    virtual void stepLocal(const std::string &agentID, std::map<std::string, int> &environmentState, SimulationContext &context) {
+      _DBNPtr->step(environmentState, "local", context.randomNumberGenerator);
+    }
+
+    // whether the simulators step a native model instead of the DBN
+    bool usesNativeModel() {
+      return _usesNativeModel;
+    }
+
+    int getNumberOfLocalStates(const std::string &agentID) {
+      std::vector<std::string> localFactors, localStates, sourceFactors, destinationFactors, dSeparationSetPerStage;
+      _DBNPtr->constructLocalModel(agentID, localFactors, localStates, sourceFactors, destinationFactors, dSeparationSetPerStage);
+      return localStates.size();
+    }
+
 protected:
   TwoStageDynamicBayesianNetwork *_DBNPtr;
   YAML::Node parameters;
@@ -395,12 +792,68 @@ protected:
   int _numberOfEnvironmentStates;
   int _numberOfStepsToPlan;
   float _discountFactor;
+  bool _usesNativeModel = false;
+
+  // native models draw from the raw output of the random number generator, a probability is an integer threshold on it
+  static constexpr uint64_t _rangeOfGenerator = (uint64_t)std::default_random_engine::max() - std::default_random_engine::min() + 1;
+
+  static uint64_t toThreshold(double probability) {
+    return (uint64_t)std::llround(std::min(1.0, std::max(0.0, probability)) * _rangeOfGenerator);
+  }
+
+  static int bernoulli(uint64_t threshold, std::default_random_engine &randomNumberGenerator) {
+    if (threshold == 0) {
+      return 0;
+    } else if (threshold >= _rangeOfGenerator) {
+      return 1;
+    }
+    return ((uint64_t)randomNumberGenerator() - std::default_random_engine::min()) < threshold;
+  }
+
+  // a variable of a generated network, in the format of the yaml files. given a distribution, its CPT holds the distribution
+  // for every combination of the values of its parents, the first parent varying slowest
+  static YAML::Node makeNetworkVariable(const std::vector<std::string> &parents, const std::vector<int> &numbersOfParentValues, const std::vector<int> &values, const std::function<std::vector<double>(const std::vector<int>&)> &distribution = nullptr) {
+    YAML::Node variable;
+    variable["parents"] = parents;
+    variable["values"] = values;
+    if (parents.size() == 0 || distribution == nullptr) {
+      return variable;
+    }
+    variable["mode"] = "CPT";
+    YAML::Node conditionalProbabilityTable(YAML::NodeType::Map);
+    std::vector<int> parentValues(parents.size(), 0);
+    while (true) {
+      conditionalProbabilityTable.force_insert(parentValues, distribution(parentValues));
+      int i = parents.size()-1;
+      while (i >= 0 && parentValues[i] == numbersOfParentValues[i]-1) {
+        parentValues[i] = 0;
+        i -= 1;
+      }
+      if (i < 0) {
+        break;
+      }
+      parentValues[i] += 1;
+    }
+    variable["CPT"] = conditionalProbabilityTable;
+    return variable;
+  }
+
+  // the values 0, 1, ..., n-1
+  static std::vector<int> rangeOfValues(int numberOfValues) {
+    std::vector<int> values(numberOfValues);
+    std::iota(values.begin(), values.end(), 0);
+    return values;
+  }
+
+  virtual std::map<std::string, int> sampleInitialState(std::default_random_engine &randomNumberGenerator) {
+    return _DBNPtr->sampleInitialState(randomNumberGenerator);
+  }
 
-  virtual std::map<std::string, int> sampleInitialState() {
-    return _DBNPtr->sampleInitialState();
+  std::map<std::string, int> sampleInitialState() {
+    return sampleInitialState(_DBNPtr->getRandomNumberGenerator());
   }
 
-  virtual void step(std::map<std::string, int> &state, std::map<std::string, int> &action, std::map<std::string, int> &observation, std::map<std::string, float> &reward, bool &done, const std::string &samplingMode) {
+  virtual void step(std::map<std::string, int> &state, std::map<std::string, int> &action, std::map<std::string, int> &observation, std::map<std::string, float> &reward, bool &done, const std::string &samplingMode, std::default_random_engine &randomNumberGenerator) {
 
     // read actions
     for (const auto &agentID: _listOfAgentIDs) {
@@ -408,7 +861,7 @@ protected:
     }
     
     // perform one step sampling in the two stage dynamic bayesian network
-    _DBNPtr->step(state, samplingMode); 
+    _DBNPtr->step(state, samplingMode, randomNumberGenerator);
 
     VLOG(4) << "Finished one step in the bayesian network.";
 
@@ -11,7 +11,7 @@ class FireFighterNaiveAtomicAgentSimulator: public AtomicAgentSimulator {
       // in the beginning, take a random action
       if (*it == 1) {
         action = 0;
-        // action = std::experimental::randint(0,1);
+        // action = RandomUtils::randint(0,1);
       } else {
         // depends on the previous action and previous observation
         int prevAction = *(it + (*it-2));
@@ -26,12 +26,62 @@ class FireFighterNaiveAtomicAgentSimulator: public AtomicAgentSimulator {
       *it += 1;
       return action;
     }
+    // compact state: [number of steps taken, previous action, previous observation]
+    int getSizeOfCompactState() {
+      return 3;
+    }
+    void resetCompactState(const std::vector<int>::iterator &it) {
+      *it = 0;
+    }
+    int stepCompact(const std::vector<int>::iterator &it) {
+      int action;
+      if (*it == 0) {
+        action = 0;
+      } else if (*(it+2) == 1) {
+        action = *(it+1);
+      } else {
+        action = 1 - *(it+1);
+      }
+      *it += 1;
+      *(it+1) = action;
+      return action;
+    }
+    void observeCompact(const std::vector<int>::iterator &it, int &observation) {
+      *(it+2) = observation;
+    }
+    std::string getPolicyKey() {
+      return "Naive";
+    }
+    void resetCompactStates(int *states, int numberOfAgents) {
+      std::fill(states, states+numberOfAgents, 0);
+    }
+    void stepCompactBatch(int *states, int numberOfAgents, int *environmentState, const int *actionIndices) {
+      int *steps = states;
+      int *prevActions = states + numberOfAgents;
+      const int *prevObservations = states + 2*numberOfAgents;
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        int action;
+        if (steps[i] == 0) {
+          action = 0;
+        } else if (prevObservations[i] == 1) {
+          action = prevActions[i];
+        } else {
+          action = 1 - prevActions[i];
+        }
+        steps[i] += 1;
+        prevActions[i] = action;
+        environmentState[actionIndices[i]] = action;
+      }
+    }
+    void observeCompactBatch(int *states, int numberOfAgents, const int *observations) {
+      std::copy(observations, observations+numberOfAgents, states + 2*numberOfAgents);
+    }
 };
 
 class FireFighterNaiveAtomicAgent: public AtomicAgent, private FireFighterNaiveAtomicAgentSimulator {
   public:
     FireFighterNaiveAtomicAgent(const std::string &agentID, const int numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters): AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters), FireFighterNaiveAtomicAgentSimulator() {}
-    int act(std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentsYAMLNode) {
+    int act(EpisodeMetrics::AgentMetrics metrics, YAML::Node &agentsYAMLNode) {
       return FireFighterNaiveAtomicAgentSimulator::step(_AOH.begin());
     }
     void observe(int &observation) {
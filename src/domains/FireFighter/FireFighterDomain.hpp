@@ -10,16 +10,119 @@ class FireFighterDomain: public Domain {
 
   public:
     
-    FireFighterDomain(const YAML::Node &parameters) : Domain(parameters) {}
+    FireFighterDomain(const YAML::Node &parameters) : Domain(withGeneratedNetwork(parameters, generateNetwork)) {}
+
+    // the network of a row of houses 1, ..., n+1 with agent i between houses i and i+1, fighting fire at house i (action 0) or i+1 (action 1).
+    // an unattended house catches fire or burns harder with the spread probability if a neighbor burns, and burns harder with the growth
+    // probability otherwise. one agent lowers the fire level for sure, or with the extinguish probability if a neighbor burns, two put it out.
+    // agents observe flames at the house they go to with the observation probability of its fire level and are rewarded minus the fire levels
+    // of both houses next to them. generated from
+    // FireFighter:
+    //   generate:
+    //     numberOfAgents: 4
+    //     numberOfFireLevels: 3
+    //     spreadProbability: 0.8
+    //     growthProbability: 0.4
+    //     extinguishProbability: 0.6
+    //     observationProbabilities: [0.2, 0.5, 0.8]   # for every fire level, the last one for higher levels
+    //     initialProbability: 0.5                     # probability that a house burns initially, at any level
+    static YAML::Node generateNetwork(const YAML::Node &domainParameters) {
+      const YAML::Node &generatorParameters = domainParameters["generate"];
+      int numberOfAgents = generatorParameters["numberOfAgents"].as<int>();
+      int numberOfFireLevels = generatorParameters["numberOfFireLevels"].IsDefined() ? generatorParameters["numberOfFireLevels"].as<int>() : 3;
+      double spreadProbability = generatorParameters["spreadProbability"].IsDefined() ? generatorParameters["spreadProbability"].as<double>() : 0.8;
+      double growthProbability = generatorParameters["growthProbability"].IsDefined() ? generatorParameters["growthProbability"].as<double>() : 0.4;
+      double extinguishProbability = generatorParameters["extinguishProbability"].IsDefined() ? generatorParameters["extinguishProbability"].as<double>() : 0.6;
+      std::vector<double> observationProbabilities = generatorParameters["observationProbabilities"].IsDefined() ? generatorParameters["observationProbabilities"].as<std::vector<double>>() : std::vector<double>{0.2, 0.5, 0.8};
+      double initialProbability = generatorParameters["initialProbability"].IsDefined() ? generatorParameters["initialProbability"].as<double>() : 0.5;
+      if (numberOfAgents < 1 || numberOfFireLevels < 2 || observationProbabilities.size() == 0) {
+        throw std::invalid_argument("FireFighter needs at least one agent, two fire levels and an observation probability.");
+      }
+
+      YAML::Node network;
+      std::vector<double> initialDistribution(numberOfFireLevels, initialProbability / (numberOfFireLevels-1));
+      initialDistribution[0] = 1.0 - initialProbability;
+      for (int h=1; h<=numberOfAgents+1; h++) {
+        std::string name = "x" + std::to_string(h);
+        YAML::Node house = makeNetworkVariable({}, {}, rangeOfValues(numberOfFireLevels));
+        house["initial_dist"] = initialDistribution;
+        network.force_insert(name, house);
+        // the neighboring houses and the agents that can come to this house
+        std::vector<std::string> parents;
+        std::vector<int> numbersOfParentValues;
+        std::vector<int> neighbors, fighters;
+        std::vector<int> fightingActions;
+        for (int neighbor: {h-1, h, h+1}) {
+          if (neighbor >= 1 && neighbor <= numberOfAgents+1) {
+            if (neighbor != h) {
+              neighbors.push_back(parents.size());
+            }
+            parents.push_back("x" + std::to_string(neighbor));
+            numbersOfParentValues.push_back(numberOfFireLevels);
+          }
+        }
+        int self = (h == 1) ? 0 : 1;
+        for (int agent: {h-1, h}) {
+          if (agent >= 1 && agent <= numberOfAgents) {
+            fighters.push_back(parents.size());
+            fightingActions.push_back(agent == h ? 0 : 1);
+            parents.push_back("a" + std::to_string(agent));
+            numbersOfParentValues.push_back(2);
+          }
+        }
+        network.force_insert(name + "'", makeNetworkVariable(parents, numbersOfParentValues, rangeOfValues(numberOfFireLevels), [&](const std::vector<int> &v) {
+          int level = v[self];
+          bool neighborBurns = false;
+          for (auto &i: neighbors) {
+            neighborBurns = neighborBurns || v[i] > 0;
+          }
+          int numberOfFighters = 0;
+          for (int i=0; i<=(int)fighters.size()-1; i++) {
+            numberOfFighters += (v[fighters[i]] == fightingActions[i]);
+          }
+          std::vector<double> distribution(numberOfFireLevels, 0.0);
+          if (numberOfFighters >= 2 || (numberOfFighters == 1 && level == 0)) {
+            distribution[0] = 1.0;
+          } else if (numberOfFighters == 1) {
+            double probability = neighborBurns ? extinguishProbability : 1.0;
+            distribution[level-1] += probability;
+            distribution[level] += 1.0 - probability;
+          } else {
+            double probability = neighborBurns ? spreadProbability : (level > 0 ? growthProbability : 0.0);
+            distribution[std::min(level+1, numberOfFireLevels-1)] += probability;
+            distribution[level] += 1.0 - probability;
+          }
+          return distribution;
+        }));
+      }
+      for (int i=1; i<=numberOfAgents; i++) {
+        std::string ID = std::to_string(i);
+        std::string leftHouse = "x" + std::to_string(i) + "'";
+        std::string rightHouse = "x" + std::to_string(i+1) + "'";
+        network.force_insert("a" + ID, makeNetworkVariable({}, {}, {0, 1}));
+        network.force_insert("o" + ID, makeNetworkVariable({"a" + ID, leftHouse, rightHouse}, {2, numberOfFireLevels, numberOfFireLevels}, {0, 1}, [&](const std::vector<int> &v) {
+          int level = (v[0] == 0) ? v[1] : v[2];
+          double probability = observationProbabilities[std::min(level, (int)observationProbabilities.size()-1)];
+          return std::vector<double>{1.0 - probability, probability};
+        }));
+        std::vector<int> rewards = rangeOfValues(2 * numberOfFireLevels - 1);
+        std::transform(rewards.begin(), rewards.end(), rewards.begin(), std::negate<int>());
+        YAML::Node reward = makeNetworkVariable({leftHouse, rightHouse}, {}, rewards);
+        reward["mode"] = "SUM";
+        network.force_insert("r" + ID, reward);
+      }
+      return network;
+    }
     
     AtomicAgentSimulator *makeAtomicAgentSimulator(const std::string &agentID, const std::string &agentType) {
-      AtomicAgentSimulator *agentSimulatorPtr;
+      AtomicAgentSimulator *agentSimulatorPtr = nullptr;
       if (agentType == "Random") {
         agentSimulatorPtr = new RandomAtomicAgentSimulator(_numberOfActions[agentID]);
       } else if (agentType == "Naive") {
         agentSimulatorPtr = new FireFighterNaiveAtomicAgentSimulator();
       } else {
-        LOG(FATAL) << "Agent type " << agentType << " not supported.";
+        std::string message = "Agent type " + agentType + " is not supported.";
+        throw std::invalid_argument(message);
       }
       return agentSimulatorPtr;
     }
@@ -38,7 +141,7 @@ class FireFighterDomain: public Domain {
       } else if (agentType == "POMCP") {
         std::string simulatorType = thisAgentParameters["Simulator"]["Type"].as<std::string>();
         if (simulatorType == "Global") {
-          atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentGlobalSimulatorState>(
+          atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentGlobalSimulatorState, Domain::SingleAgentGlobalSimulator>(
             agentID, 
             _numberOfActions[agentID], 
             _numberOfStepsToPlan, 
@@ -53,7 +156,7 @@ class FireFighterDomain: public Domain {
         } else if (simulatorType == "Local") {
           bool recurrent = thisAgentParameters["Simulator"]["InfluencePredictor"]["recurrent"].as<bool>();
           if (recurrent == false) {
-            atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentSequentialInfluenceAugmentedSimulatorState>(
+            atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentSequentialInfluenceAugmentedSimulatorState, Domain::SingleAgentSequentialInfluenceAugmentedSimulator>(
               agentID, 
               _numberOfActions[agentID], 
               _numberOfStepsToPlan, 
@@ -66,28 +169,22 @@ class FireFighterDomain: public Domain {
               )
             );
           } else {
-            atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentRecurrentInfluenceAugmentedSimulatorState>(
+            atomicAgentPtr = makeRecurrentInfluenceAugmentedPOMCPAtomicAgent(
               agentID, 
               _numberOfActions[agentID], 
               _numberOfStepsToPlan, 
               _discountFactor,
               thisAgentParameters,
-              new Domain::SingleAgentRecurrentInfluenceAugmentedSimulator(
-                agentID, 
-                this, 
-                thisAgentParameters["Simulator"]
-              )
+              this
             );
           }
         } else {
           std::string message = "Unsupported simulator type: " + simulatorType + ".";
-          LOG(FATAL) << message;
-          return nullptr;
+          throw std::invalid_argument(message);
         }
       } else {
         std::string message = "Agent Type " + agentType + " is not supported.";
-        LOG(FATAL) << message;
-        atomicAgentPtr == nullptr;
+        throw std::invalid_argument(message);
       }
       return atomicAgentPtr;
     }
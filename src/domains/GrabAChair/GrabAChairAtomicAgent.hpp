@@ -5,33 +5,79 @@ class GrabAChairPatternAtomicAgentSimulator: public AtomicAgentSimulator {
     GrabAChairPatternAtomicAgentSimulator(int frequency): AtomicAgentSimulator() {
       _freq = frequency;
     }
+    // the previous action is read from the history so that the simulator has no state of its own
     int step(const std::vector<int>::iterator &it) {
       int action;
       if (*it == 1) {
         action = 0; // always start with left
       } else {
+        int prevAction = *(it + (*it)-2);
         if ((*it - 1) % _freq == 0) {
-          action = 1 - _prevAction;
+          action = 1 - prevAction;
         } else {
-          action = _prevAction;
+          action = prevAction;
         }
       }
       *(it + *it) = action;
       *it += 1;
-      _prevAction = action;
       return action;
     }
+    // compact state: [number of steps taken, previous action]
+    int getSizeOfCompactState() {
+      return 2;
+    }
+    void resetCompactState(const std::vector<int>::iterator &it) {
+      *it = 0;
+    }
+    int stepCompact(const std::vector<int>::iterator &it) {
+      int action;
+      if (*it == 0) {
+        action = 0;
+      } else {
+        if ((2 * (*it)) % _freq == 0) {
+          action = 1 - *(it+1);
+        } else {
+          action = *(it+1);
+        }
+      }
+      *it += 1;
+      *(it+1) = action;
+      return action;
+    }
+    std::string getPolicyKey() {
+      return "Pattern" + std::to_string(_freq);
+    }
+    void resetCompactStates(int *states, int numberOfAgents) {
+      std::fill(states, states+numberOfAgents, 0);
+    }
+    void stepCompactBatch(int *states, int numberOfAgents, int *environmentState, const int *actionIndices) {
+      int *steps = states;
+      int *prevActions = states + numberOfAgents;
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        int action;
+        if (steps[i] == 0) {
+          action = 0;
+        } else if ((2 * steps[i]) % _freq == 0) {
+          action = 1 - prevActions[i];
+        } else {
+          action = prevActions[i];
+        }
+        steps[i] += 1;
+        prevActions[i] = action;
+        environmentState[actionIndices[i]] = action;
+      }
+    }
+    void observeCompactBatch(int *states, int numberOfAgents, const int *observations) {}
   private:
-    int _prevAction;
     int _freq;
 };
 
 class GrabAChairPatternAtomicAgent: public AtomicAgent, private GrabAChairPatternAtomicAgentSimulator {
   public:
-    GrabAChairPatternAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters, int freq): GrabAChairPatternAtomicAgentSimulator(freq), AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters) {
+    GrabAChairPatternAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters, int freq): AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters), GrabAChairPatternAtomicAgentSimulator(freq) {
 
     }
-    int act(std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentYAMLNode) {
+    int act(EpisodeMetrics::AgentMetrics metrics, YAML::Node &agentYAMLNode) {
       return GrabAChairPatternAtomicAgentSimulator::step(_AOH.begin());
     }
     virtual void observe(int &observation) {
@@ -48,7 +94,7 @@ class GrabAChairCountBasedAtomicAgentSimulator: public AtomicAgentSimulator {
 
       if (_memorySize == 0) {
         // no memory means fully random
-        action = std::experimental::randint(0, 1);
+        action = RandomUtils::randint(0, 1);
       } else {
         int startingPoint;
         double sum0 = 0.0;
@@ -83,7 +129,7 @@ class GrabAChairCountBasedAtomicAgentSimulator: public AtomicAgentSimulator {
         } else if (avg1 < avg0) {
           action = 0;
         } else {
-          action = std::experimental::randint(0, 1);
+          action = RandomUtils::randint(0, 1);
         }
       }
 
@@ -91,8 +137,101 @@ class GrabAChairCountBasedAtomicAgentSimulator: public AtomicAgentSimulator {
       *it += 1;
       return action;
     }
+    // compact state: [pending action, count0, sum0, count1, sum1] with running counts and sums of the observations after each action
+    // a finite memory adds a ring buffer of the last memorySize pairs, [next, filled, actions..., observations...],
+    // whose expired pair is subtracted from the counts and sums on observe
+    // observations are integers so the sums are exact
+    int getSizeOfCompactState() {
+      if (_memorySize == 0) {
+        return 0;
+      } else if (_memorySize == -1) {
+        return 5;
+      } else {
+        return 7 + 2 * _memorySize;
+      }
+    }
+    void resetCompactState(const std::vector<int>::iterator &it) {
+      if (_memorySize != 0) {
+        resetCompactStates(&*it, 1);
+      }
+    }
+    int stepCompact(const std::vector<int>::iterator &it) {
+      if (_memorySize == 0) {
+        return RandomUtils::randint(0, 1);
+      }
+      int action;
+      int actionIndex = 0;
+      stepCompactBatch(&*it, 1, &action, &actionIndex);
+      return action;
+    }
+    void observeCompact(const std::vector<int>::iterator &it, int &observation) {
+      if (_memorySize != 0) {
+        observeCompactBatch(&*it, 1, &observation);
+      }
+    }
+    std::string getPolicyKey() {
+      return "Count" + std::to_string(_memorySize);
+    }
+    void resetCompactStates(int *states, int numberOfAgents) {
+      std::fill(states, states+getSizeOfCompactState()*numberOfAgents, 0);
+    }
+    void stepCompactBatch(int *states, int numberOfAgents, int *environmentState, const int *actionIndices) {
+      if (_memorySize == 0) {
+        for (int i=0; i<=numberOfAgents-1; i++) {
+          environmentState[actionIndices[i]] = RandomUtils::randint(0, 1);
+        }
+        return;
+      }
+      int *pendingActions = states;
+      const int *counts0 = states + numberOfAgents;
+      const int *sums0 = states + 2*numberOfAgents;
+      const int *counts1 = states + 3*numberOfAgents;
+      const int *sums1 = states + 4*numberOfAgents;
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        double avg0 = this->getAverage(sums0[i], counts0[i]);
+        double avg1 = this->getAverage(sums1[i], counts1[i]);
+        int action;
+        if (avg1 > avg0) {
+          action = 1;
+        } else if (avg1 < avg0) {
+          action = 0;
+        } else {
+          action = RandomUtils::randint(0, 1);
+        }
+        pendingActions[i] = action;
+        environmentState[actionIndices[i]] = action;
+      }
+    }
+    void observeCompactBatch(int *states, int numberOfAgents, const int *observations) {
+      if (_memorySize == 0) {
+        return;
+      }
+      const int *pendingActions = states;
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        if (_memorySize > 0) {
+          int &next = states[5*numberOfAgents+i];
+          int &filled = states[6*numberOfAgents+i];
+          int &ringAction = states[(7+next)*numberOfAgents+i];
+          int &ringObservation = states[(7+_memorySize+next)*numberOfAgents+i];
+          if (filled == _memorySize) {
+            // forget the oldest pair
+            int offset = (1 + 2*ringAction) * numberOfAgents + i;
+            states[offset] -= 1;
+            states[offset+numberOfAgents] -= ringObservation;
+          } else {
+            filled += 1;
+          }
+          ringAction = pendingActions[i];
+          ringObservation = observations[i];
+          next = (next + 1) % _memorySize;
+        }
+        // count and sum of the pending action
+        int offset = (1 + 2*pendingActions[i]) * numberOfAgents + i;
+        states[offset] += 1;
+        states[offset+numberOfAgents] += observations[i];
+      }
+    }
   protected:
-    std::default_random_engine rg;
     int _memorySize;
 
     // if count = 0 return 0 otherwise return sum/count
@@ -107,15 +246,27 @@ class GrabAChairCountBasedAtomicAgentSimulator: public AtomicAgentSimulator {
 
 class GrabAChairCountBasedAtomicAgent: public AtomicAgent, private GrabAChairCountBasedAtomicAgentSimulator {
   public:
-    GrabAChairCountBasedAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters): GrabAChairCountBasedAtomicAgentSimulator(parameters["memorySize"].as<int>()), AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters) {
+    GrabAChairCountBasedAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters): AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters), GrabAChairCountBasedAtomicAgentSimulator(parameters["memorySize"].as<int>()) {
 
     }
-    int act(std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentYAMLNode) {
-      return GrabAChairCountBasedAtomicAgentSimulator::step(_AOH.begin());
+    void reset() {
+      AtomicAgent::reset();
+      _compactState.assign(getSizeOfCompactState(), 0);
+      GrabAChairCountBasedAtomicAgentSimulator::resetCompactState(_compactState.begin());
+    }
+    // acts on the running statistics, the AOH is kept for completeness
+    int act(EpisodeMetrics::AgentMetrics metrics, YAML::Node &agentYAMLNode) {
+      int action = GrabAChairCountBasedAtomicAgentSimulator::stepCompact(_compactState.begin());
+      *(_AOH.begin() + _AOH[0]) = action;
+      _AOH[0] += 1;
+      return action;
     }
     virtual void observe(int &observation) {
+      GrabAChairCountBasedAtomicAgentSimulator::observeCompact(_compactState.begin(), observation);
       GrabAChairCountBasedAtomicAgentSimulator::observe(_AOH.begin(), observation);
     }
+  private:
+    std::vector<int> _compactState;
 };
 
 class GrabAChairHappyAtomicAgentSimulator: public AtomicAgentSimulator {
@@ -124,7 +275,7 @@ class GrabAChairHappyAtomicAgentSimulator: public AtomicAgentSimulator {
     int step(const std::vector<int>::iterator &it) {
       int action; 
       if (*it == 1) {
-        action = std::experimental::randint(0,1);
+        action = RandomUtils::randint(0,1);
       } else {
         int prevAction = *(it + (*it)-2);
         int prevObs = *(it + (*it)-1);
@@ -140,14 +291,64 @@ class GrabAChairHappyAtomicAgentSimulator: public AtomicAgentSimulator {
       *it += 1;
       return action;
     }
+    // compact state: [number of steps taken, previous action, previous observation]
+    int getSizeOfCompactState() {
+      return 3;
+    }
+    void resetCompactState(const std::vector<int>::iterator &it) {
+      *it = 0;
+    }
+    int stepCompact(const std::vector<int>::iterator &it) {
+      int action;
+      if (*it == 0) {
+        action = RandomUtils::randint(0,1);
+      } else if (*(it+2) == 1) {
+        action = *(it+1);
+      } else {
+        action = 1 - *(it+1);
+      }
+      *it += 1;
+      *(it+1) = action;
+      return action;
+    }
+    void observeCompact(const std::vector<int>::iterator &it, int &observation) {
+      *(it+2) = observation;
+    }
+    std::string getPolicyKey() {
+      return "Happy";
+    }
+    void resetCompactStates(int *states, int numberOfAgents) {
+      std::fill(states, states+numberOfAgents, 0);
+    }
+    void stepCompactBatch(int *states, int numberOfAgents, int *environmentState, const int *actionIndices) {
+      int *steps = states;
+      int *prevActions = states + numberOfAgents;
+      const int *prevObservations = states + 2*numberOfAgents;
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        int action;
+        if (steps[i] == 0) {
+          action = RandomUtils::randint(0,1);
+        } else if (prevObservations[i] == 1) {
+          action = prevActions[i];
+        } else {
+          action = 1 - prevActions[i];
+        }
+        steps[i] += 1;
+        prevActions[i] = action;
+        environmentState[actionIndices[i]] = action;
+      }
+    }
+    void observeCompactBatch(int *states, int numberOfAgents, const int *observations) {
+      std::copy(observations, observations+numberOfAgents, states + 2*numberOfAgents);
+    }
 };
 
 class GrabAChairHappyAtomicAgent: public AtomicAgent, private GrabAChairHappyAtomicAgentSimulator {
   public:
-    GrabAChairHappyAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters): GrabAChairHappyAtomicAgentSimulator(), AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters) {
+    GrabAChairHappyAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters): AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters), GrabAChairHappyAtomicAgentSimulator() {
 
     }
-    int act(std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentYAMLNode) {
+    int act(EpisodeMetrics::AgentMetrics metrics, YAML::Node &agentYAMLNode) {
       return GrabAChairHappyAtomicAgentSimulator::step(_AOH.begin());
     }
     virtual void observe(int &observation) {
@@ -161,7 +362,7 @@ class GrabAChairSadAtomicAgentSimulator: public AtomicAgentSimulator {
     int step(const std::vector<int>::iterator &it) {
       int action; 
       if (*it == 1) {
-        action = std::experimental::randint(0,1);
+        action = RandomUtils::randint(0,1);
       } else {
         int prevAction = *(it + (*it)-2);
         int prevObs = *(it + (*it)-1);
@@ -177,14 +378,64 @@ class GrabAChairSadAtomicAgentSimulator: public AtomicAgentSimulator {
       *it += 1;
       return action;
     }
+    // compact state: [number of steps taken, previous action, previous observation]
+    int getSizeOfCompactState() {
+      return 3;
+    }
+    void resetCompactState(const std::vector<int>::iterator &it) {
+      *it = 0;
+    }
+    int stepCompact(const std::vector<int>::iterator &it) {
+      int action;
+      if (*it == 0) {
+        action = RandomUtils::randint(0,1);
+      } else if (*(it+2) == 1) {
+        action = 1 - *(it+1);
+      } else {
+        action = *(it+1);
+      }
+      *it += 1;
+      *(it+1) = action;
+      return action;
+    }
+    void observeCompact(const std::vector<int>::iterator &it, int &observation) {
+      *(it+2) = observation;
+    }
+    std::string getPolicyKey() {
+      return "Sad";
+    }
+    void resetCompactStates(int *states, int numberOfAgents) {
+      std::fill(states, states+numberOfAgents, 0);
+    }
+    void stepCompactBatch(int *states, int numberOfAgents, int *environmentState, const int *actionIndices) {
+      int *steps = states;
+      int *prevActions = states + numberOfAgents;
+      const int *prevObservations = states + 2*numberOfAgents;
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        int action;
+        if (steps[i] == 0) {
+          action = RandomUtils::randint(0,1);
+        } else if (prevObservations[i] == 1) {
+          action = 1 - prevActions[i];
+        } else {
+          action = prevActions[i];
+        }
+        steps[i] += 1;
+        prevActions[i] = action;
+        environmentState[actionIndices[i]] = action;
+      }
+    }
+    void observeCompactBatch(int *states, int numberOfAgents, const int *observations) {
+      std::copy(observations, observations+numberOfAgents, states + 2*numberOfAgents);
+    }
 };
 
 class GrabAChairSadAtomicAgent: public AtomicAgent, private GrabAChairSadAtomicAgentSimulator {
   public:
-    GrabAChairSadAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters): GrabAChairSadAtomicAgentSimulator(), AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters) {
+    GrabAChairSadAtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters): AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters), GrabAChairSadAtomicAgentSimulator() {
 
     }
-    int act(std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentYAMLNode) {
+    int act(EpisodeMetrics::AgentMetrics metrics, YAML::Node &agentYAMLNode) {
       return GrabAChairSadAtomicAgentSimulator::step(_AOH.begin());
     }
     virtual void observe(int &observation) {
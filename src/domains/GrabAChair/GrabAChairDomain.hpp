@@ -10,10 +10,116 @@ class GrabAChairDomain: public Domain {
 
   public:
     
-    GrabAChairDomain(const YAML::Node &parameters) : Domain(parameters) {}
+    GrabAChairDomain(const YAML::Node &parameters) : Domain(withGeneratedNetwork(parameters, generateNetwork)) {
+      if (parameters["GrabAChair"]["native"].IsDefined() && parameters["GrabAChair"]["native"].as<bool>() == true) {
+        _usesNativeModel = buildNativeModel();
+        if (_usesNativeModel == true) {
+          LOG(INFO) << "Simulators of GrabAChair step the native model of " << _ring.size() << " agents.";
+        } else {
+          LOG(WARNING) << "The DBN does not have the structure of GrabAChair, simulators step the DBN.";
+        }
+      }
+    }
+
+    // the network of a ring of agents 1, ..., n, generated from
+    // GrabAChair:
+    //   generate:
+    //     numberOfAgents: 129
+    //     coupling: 0.0           # probability of getting a chair a neighbor also goes for
+    //     observationNoise: 0.2   # probability of observing the wrong outcome
+    static YAML::Node generateNetwork(const YAML::Node &domainParameters) {
+      const YAML::Node &generatorParameters = domainParameters["generate"];
+      int numberOfAgents = generatorParameters["numberOfAgents"].as<int>();
+      double coupling = generatorParameters["coupling"].IsDefined() ? generatorParameters["coupling"].as<double>() : 0.0;
+      double observationNoise = generatorParameters["observationNoise"].IsDefined() ? generatorParameters["observationNoise"].as<double>() : 0.2;
+      if (numberOfAgents < 2) {
+        throw std::invalid_argument("GrabAChair needs at least two agents.");
+      }
+      YAML::Node network;
+      for (int i=1; i<=numberOfAgents; i++) {
+        std::string ID = std::to_string(i);
+        std::string leftID = std::to_string(i == 1 ? numberOfAgents : i-1);
+        std::string rightID = std::to_string(i == numberOfAgents ? 1 : i+1);
+        YAML::Node action = makeNetworkVariable({}, {}, {0, 1});
+        action["initial_dist"] = std::vector<double>{0.5, 0.5};
+        network.force_insert("a" + ID, action);
+        YAML::Node chair = makeNetworkVariable({}, {}, {0, 1});
+        chair["initial_dist"] = std::vector<double>{0.5, 0.5};
+        network.force_insert("x" + ID, chair);
+        network.force_insert("x" + ID + "'", makeNetworkVariable({"a" + leftID, "a" + ID, "a" + rightID}, {2, 2, 2}, {0, 1}, [&](const std::vector<int> &v) {
+          bool contended = (v[1] == 0) ? (v[0] == 1) : (v[2] == 0);
+          return contended == true ? std::vector<double>{1.0 - coupling, coupling} : std::vector<double>{0.0, 1.0};
+        }));
+        network.force_insert("o" + ID, makeNetworkVariable({"x" + ID + "'"}, {2}, {0, 1}, [&](const std::vector<int> &v) {
+          return v[0] == 1 ? std::vector<double>{observationNoise, 1.0 - observationNoise} : std::vector<double>{1.0 - observationNoise, observationNoise};
+        }));
+        network.force_insert("r" + ID, makeNetworkVariable({"x" + ID + "'"}, {2}, {0, 1}, [&](const std::vector<int> &v) {
+          return v[0] == 1 ? std::vector<double>{0.0, 1.0} : std::vector<double>{1.0, 0.0};
+        }));
+      }
+      return network;
+    }
+
+    // agents sit on a ring, with a chair between every two neighbors. an agent takes the chair on its left (action 0) or right (action 1)
+    // and gets it for sure if the neighbor on that side goes the other way, otherwise with the coupling probability of the DBN
+    void stepGlobal(std::vector<int> &environmentState, SimulationContext &context) {
+      if (_usesNativeModel == false) {
+        Domain::stepGlobal(environmentState, context);
+        return;
+      }
+      int numberOfAgents = _ring.size();
+      int numberOfWords = (numberOfAgents + 63) / 64;
+      if ((int)context.bitsets.size() < 3 * numberOfWords) {
+        context.bitsets.resize(3 * numberOfWords);
+      }
+      uint64_t *actions = context.bitsets.data();
+      uint64_t *leftActions = actions + numberOfWords;
+      uint64_t *rightActions = leftActions + numberOfWords;
+      // bit k is the action of the k-th agent on the ring
+      std::fill(actions, actions + numberOfWords, 0);
+      for (int k=0; k<=numberOfAgents-1; k++) {
+        actions[k >> 6] |= (uint64_t)(environmentState[_ring[k].actionIndex] & 1) << (k & 63);
+      }
+      // actions of the left and right neighbors, by rotating the ring one position either way
+      uint64_t lastBit = (actions[(numberOfAgents-1) >> 6] >> ((numberOfAgents-1) & 63)) & 1;
+      for (int w=0; w<=numberOfWords-1; w++) {
+        leftActions[w] = (actions[w] << 1) | (w == 0 ? lastBit : actions[w-1] >> 63);
+        rightActions[w] = (actions[w] >> 1) | (w == numberOfWords-1 ? 0 : actions[w+1] << 63);
+      }
+      rightActions[(numberOfAgents-1) >> 6] |= (actions[0] & 1) << ((numberOfAgents-1) & 63);
+      std::default_random_engine &randomNumberGenerator = context.randomNumberGenerator;
+      for (int w=0; w<=numberOfWords-1; w++) {
+        // going left contends with a left neighbor going right, going right with a right neighbor going left
+        uint64_t contended = (~actions[w] & leftActions[w]) | (actions[w] & ~rightActions[w]);
+        int end = std::min(64, numberOfAgents - 64 * w);
+        for (int b=0; b<=end-1; b++) {
+          const RingPosition &agent = _ring[64 * w + b];
+          int chair = ((contended >> b) & 1) == 0 ? 1 : bernoulli(agent.contendedThreshold, randomNumberGenerator);
+          environmentState[agent.nextStateIndex] = chair;
+          environmentState[agent.stateIndex] = chair;
+          environmentState[agent.rewardIndex] = chair;
+          environmentState[agent.observationIndex] = bernoulli(agent.observationThresholds[chair], randomNumberGenerator);
+        }
+      }
+    }
+
+    void stepLocal(const std::string &agentID, std::map<std::string, int> &environmentState, SimulationContext &context) {
+      if (_usesNativeModel == false) {
+        Domain::stepLocal(agentID, environmentState, context);
+        return;
+      }
+      const RingPosition &agent = _ring[_positionsOnRing.at(agentID)];
+      int action = environmentState.at(agent.actionName);
+      bool contended = (action == 0) ? (environmentState.at(agent.leftActionName) == 1) : (environmentState.at(agent.rightActionName) == 0);
+      int chair = contended == false ? 1 : bernoulli(agent.contendedThreshold, context.randomNumberGenerator);
+      environmentState[agent.nextStateName] = chair;
+      environmentState[agent.stateName] = chair;
+      environmentState[agent.rewardName] = chair;
+      environmentState[agent.observationName] = bernoulli(agent.observationThresholds[chair], context.randomNumberGenerator);
+    }
     
     AtomicAgentSimulator *makeAtomicAgentSimulator(const std::string &agentID, const std::string &agentType) {
-      AtomicAgentSimulator *agentSimulatorPtr;
+      AtomicAgentSimulator *agentSimulatorPtr = nullptr;
       if (agentType == "Random") {
         agentSimulatorPtr = new RandomAtomicAgentSimulator(_numberOfActions[agentID]);
       } else if (agentType[0] == 'A') {
@@ -27,7 +133,8 @@ class GrabAChairDomain: public Domain {
       } else if (agentType == "Sad") {
         agentSimulatorPtr = new GrabAChairSadAtomicAgentSimulator();
       } else {
-        LOG(FATAL) << "Agent type " << agentType << " not supported.";
+        std::string message = "Agent type " + agentType + " is not supported.";
+        throw std::invalid_argument(message);
       }
       return agentSimulatorPtr;
     }
@@ -56,7 +163,7 @@ class GrabAChairDomain: public Domain {
       } else if (agentType == "POMCP") {
         std::string simulatorType = thisAgentParameters["Simulator"]["Type"].as<std::string>();
         if (simulatorType == "Global") {
-          atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentGlobalSimulatorState>(
+          atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentGlobalSimulatorState, Domain::SingleAgentGlobalSimulator>(
             agentID, 
             _numberOfActions[agentID], 
             _numberOfStepsToPlan, 
@@ -71,7 +178,7 @@ class GrabAChairDomain: public Domain {
         } else if (simulatorType == "Local") {
           bool recurrent = thisAgentParameters["Simulator"]["InfluencePredictor"]["recurrent"].as<bool>();
           if (recurrent == false) {
-            atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentSequentialInfluenceAugmentedSimulatorState>(
+            atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentSequentialInfluenceAugmentedSimulatorState, Domain::SingleAgentSequentialInfluenceAugmentedSimulator>(
               agentID, 
               _numberOfActions[agentID], 
               _numberOfStepsToPlan, 
@@ -84,31 +191,134 @@ class GrabAChairDomain: public Domain {
               )
             );
           } else {
-            atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentRecurrentInfluenceAugmentedSimulatorState>(
+            atomicAgentPtr = makeRecurrentInfluenceAugmentedPOMCPAtomicAgent(
               agentID, 
               _numberOfActions[agentID], 
               _numberOfStepsToPlan, 
               _discountFactor,
               thisAgentParameters,
-              new Domain::SingleAgentRecurrentInfluenceAugmentedSimulator(
-                agentID, 
-                this, 
-                thisAgentParameters["Simulator"]
-              )
+              this
             );
           }
         } else {
           std::string message = "Unsupported simulator type: " + simulatorType + ".";
-          LOG(FATAL) << message;
-          return nullptr;
+          throw std::invalid_argument(message);
         }
       } else {
         std::string message = "Agent Type " + agentType + " is not supported.";
-        LOG(FATAL) << message;
-        atomicAgentPtr == nullptr;
+        throw std::invalid_argument(message);
       }
       return atomicAgentPtr;
     }
+
+  private:
+    // an agent of the native model, with the indices of its variables in the dense state and their names in local states
+    struct RingPosition {
+      int actionIndex;
+      int stateIndex;
+      int nextStateIndex;
+      int observationIndex;
+      int rewardIndex;
+      std::string actionName;
+      std::string leftActionName;
+      std::string rightActionName;
+      std::string stateName;
+      std::string nextStateName;
+      std::string observationName;
+      std::string rewardName;
+      uint64_t contendedThreshold; // the probability of getting a contended chair
+      uint64_t observationThresholds[2]; // the probability of observing 1 given whether the agent got a chair
+    };
+    std::vector<RingPosition> _ring;
+    std::map<std::string, int> _positionsOnRing;
+
+    // read the ring and the probabilities from the DBN, false if the DBN is not a GrabAChair network
+    bool buildNativeModel() {
+      TwoStageDynamicBayesianNetwork *DBNPtr = _DBNPtr;
+      std::map<std::string, std::string> leftNeighbors;
+      std::map<std::string, std::string> rightNeighbors;
+      std::map<std::string, RingPosition> positions;
+      // actions, chairs, next chairs, observations and rewards of all agents, nothing else
+      if (DBNPtr->getNumberOfVariables() != 5 * (int)_numberOfActions.size()) {
+        return false;
+      }
+      for (auto &[agentID, numberOfActions]: _numberOfActions) {
+        std::string nextStateName = "x" + agentID + "'";
+        std::string observationName = "o" + agentID;
+        std::string rewardName = "r" + agentID;
+        if (numberOfActions != 2) {
+          return false;
+        }
+        for (auto name: {std::string("x" + agentID), nextStateName, observationName, rewardName}) {
+          if (DBNPtr->hasVariable(name) == false || DBNPtr->getVariable(name)->getNumberOfValues() != 2) {
+            return false;
+          }
+        }
+        // the next chair depends on the actions of the left neighbor, the agent and the right neighbor
+        TwoStageDynamicBayesianNetworkVariable *nextStatePtr = DBNPtr->getVariable(nextStateName);
+        std::vector<std::string> parents = nextStatePtr->getListOfParents();
+        if (nextStatePtr->getMode() != CPT || parents.size() != 3 || parents[1] != "a" + agentID || parents[0][0] != 'a' || parents[2][0] != 'a') {
+          return false;
+        }
+        leftNeighbors[agentID] = parents[0].substr(1);
+        rightNeighbors[agentID] = parents[2].substr(1);
+        double contendedProbability = -1.0;
+        for (int left=0; left<=1; left++) {
+          for (int action=0; action<=1; action++) {
+            for (int right=0; right<=1; right++) {
+              double probability = nextStatePtr->getConditionalProbabilities({left, action, right})[1];
+              bool contended = (action == 0) ? (left == 1) : (right == 0);
+              if (contended == false && probability != 1.0) {
+                return false;
+              } else if (contended == true) {
+                if (contendedProbability >= 0.0 && std::abs(probability - contendedProbability) > 1e-6) {
+                  return false;
+                }
+                contendedProbability = probability;
+              }
+            }
+          }
+        }
+        // the reward is the chair, the observation is a noisy chair
+        TwoStageDynamicBayesianNetworkVariable *rewardPtr = DBNPtr->getVariable(rewardName);
+        TwoStageDynamicBayesianNetworkVariable *observationPtr = DBNPtr->getVariable(observationName);
+        if (rewardPtr->getMode() != CPT || rewardPtr->getListOfParents() != std::vector<std::string>{nextStateName} || rewardPtr->getConditionalProbabilities({0})[1] != 0.0 || rewardPtr->getConditionalProbabilities({1})[1] != 1.0) {
+          return false;
+        }
+        if (observationPtr->getMode() != CPT || observationPtr->getListOfParents() != std::vector<std::string>{nextStateName}) {
+          return false;
+        }
+        RingPosition &position = positions[agentID];
+        position.actionIndex = DBNPtr->getIndexOfVariable("a" + agentID);
+        position.stateIndex = DBNPtr->getIndexOfVariable("x" + agentID);
+        position.nextStateIndex = DBNPtr->getIndexOfVariable(nextStateName);
+        position.observationIndex = DBNPtr->getIndexOfVariable(observationName);
+        position.rewardIndex = DBNPtr->getIndexOfVariable(rewardName);
+        position.actionName = "a" + agentID;
+        position.leftActionName = parents[0];
+        position.rightActionName = parents[2];
+        position.stateName = "x" + agentID;
+        position.nextStateName = nextStateName;
+        position.observationName = observationName;
+        position.rewardName = rewardName;
+        position.contendedThreshold = toThreshold(contendedProbability);
+        position.observationThresholds[0] = toThreshold(observationPtr->getConditionalProbabilities({0})[1]);
+        position.observationThresholds[1] = toThreshold(observationPtr->getConditionalProbabilities({1})[1]);
+      }
+      // walk the ring to the right, every agent has to be visited once
+      std::string agentID = _numberOfActions.begin()->first;
+      for (int k=0; k<=(int)_numberOfActions.size()-1; k++) {
+        if (_positionsOnRing.count(agentID) != 0 || positions.count(rightNeighbors.at(agentID)) == 0 || leftNeighbors.at(rightNeighbors.at(agentID)) != agentID) {
+          _ring.clear();
+          _positionsOnRing.clear();
+          return false;
+        }
+        _positionsOnRing[agentID] = k;
+        _ring.push_back(positions.at(agentID));
+        agentID = rightNeighbors.at(agentID);
+      }
+      return true;
+    }
 };
 
 #endif
\ No newline at end of file
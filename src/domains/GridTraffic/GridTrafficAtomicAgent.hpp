@@ -3,87 +3,91 @@
 
 class GridTrafficSimple2AtomicAgentSimulator: public AtomicAgentSimulator {
   public:
+    // an observation packs four groups of obsLength bits, bit i of the observation is bit i of the groups in order
+    // the horizontal score is the first group minus the second, the vertical score the third minus the fourth
     GridTrafficSimple2AtomicAgentSimulator(int obsLength=2): AtomicAgentSimulator() {
       this->obsLength = obsLength;
-      std::vector<std::vector<int>> binaryVectors;
-      generateBinaryVectors(binaryVectors, 4*obsLength);
-      for (auto &vec: binaryVectors) {
-        bitMap[getExponentialSum(vec)] = vec;
-      }  
+      laneMask = (1u << obsLength) - 1;
     }
     int step(const std::vector<int>::iterator &it) {
       int action;
       if ((*it) == 1) {
-        action = std::experimental::randint(0, 1);
+        action = RandomUtils::randint(0, 1);
       } else {
-        int currentObs = *(it + (*it) - 1);
-        std::vector<int> &bits = bitMap[currentObs];
-        int hScore = 0;
-        int vScore = 0;
-        for (int i=0; i<=obsLength-1; i++) {
-          hScore += bits[i];
-          hScore -= bits[i+obsLength];
-          vScore += bits[2*obsLength+i];
-          vScore -= bits[3*obsLength+i];
-        }
-        if (hScore > vScore) {
-          action = 0;
-        } else if (vScore > hScore) {
-          action = 1;
-        } else {
-          action = std::experimental::randint(0, 1);
-        }
+        action = chooseAction(*(it + (*it) - 1));
       }
       *(it + *it) = action;
       *it += 1;
       return action;
     }
-  protected:
-    std::default_random_engine rg;
-    std::map<int, std::vector<int>> bitMap;
-    void generateBinaryVectors(std::vector<std::vector<int>> &vector, int numDigits) {
-      if (numDigits == 0) {
-        return;
+    // compact state: [number of steps taken, last observation]
+    int getSizeOfCompactState() {
+      return 2;
+    }
+    void resetCompactState(const std::vector<int>::iterator &it) {
+      *it = 0;
+    }
+    int stepCompact(const std::vector<int>::iterator &it) {
+      int action;
+      if (*it == 0) {
+        action = RandomUtils::randint(0, 1);
       } else {
-        if (vector.size() == 0) {
-            vector.push_back(std::vector<int>({0}));
-            vector.push_back(std::vector<int>({1}));
+        action = chooseAction(*(it+1));
+      }
+      *it += 1;
+      return action;
+    }
+    void observeCompact(const std::vector<int>::iterator &it, int &observation) {
+      *(it+1) = observation;
+    }
+    std::string getPolicyKey() {
+      return "Simple2" + std::to_string(obsLength);
+    }
+    void resetCompactStates(int *states, int numberOfAgents) {
+      std::fill(states, states+numberOfAgents, 0);
+    }
+    void stepCompactBatch(int *states, int numberOfAgents, int *environmentState, const int *actionIndices) {
+      int *steps = states;
+      const int *lastObservations = states + numberOfAgents;
+      for (int i=0; i<=numberOfAgents-1; i++) {
+        if (steps[i] == 0) {
+          environmentState[actionIndices[i]] = RandomUtils::randint(0, 1);
         } else {
-            std::vector<std::vector<int>> newVector;
-            for (auto &vec: vector) {
-                std::vector<int> vec1 = vec;
-                std::vector<int> vec2 = vec;
-                vec1.push_back(0);
-                vec2.push_back(1);
-                newVector.push_back(vec1);
-                newVector.push_back(vec2);
-            }
-            vector.clear();
-            for (auto &vec: newVector) {
-                vector.push_back(vec);
-            }
+          environmentState[actionIndices[i]] = chooseAction(lastObservations[i]);
         }
-        generateBinaryVectors(vector, numDigits-1);
+        steps[i] += 1;
       }
     }
-    int getExponentialSum(std::vector<int> &vec){
-      int count = 0;
-      int sum = 0;
-      for (auto n: vec) {
-        sum += n * std::pow(2, count);
-        count += 1;
+    void observeCompactBatch(int *states, int numberOfAgents, const int *observations) {
+      std::copy(observations, observations+numberOfAgents, states + numberOfAgents);
+    }
+  protected:
+    // favour the direction with more incoming traffic in the current observation
+    int chooseAction(int currentObs) {
+      unsigned int bits = currentObs;
+      int hScore = countCars(bits, 0) - countCars(bits, 1);
+      int vScore = countCars(bits, 2) - countCars(bits, 3);
+      if (hScore > vScore) {
+        return 0;
+      } else if (vScore > hScore) {
+        return 1;
+      } else {
+        return RandomUtils::randint(0, 1);
       }
-      return sum;
     }
+    int countCars(unsigned int bits, int lane) {
+      return __builtin_popcount((bits >> (lane * obsLength)) & laneMask);
+    }
+    unsigned int laneMask;
     int obsLength;
 };
 
 class GridTrafficSimple2AtomicAgent: public AtomicAgent, private GridTrafficSimple2AtomicAgentSimulator {
   public:
-    GridTrafficSimple2AtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters, int obsLength): GridTrafficSimple2AtomicAgentSimulator(obsLength), AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters) {
+    GridTrafficSimple2AtomicAgent(const std::string &agentID, const int &numberOfActions, int numberOfStepsToPlan, const YAML::Node &parameters, int obsLength): AtomicAgent(agentID, numberOfActions, numberOfStepsToPlan, parameters), GridTrafficSimple2AtomicAgentSimulator(obsLength) {
 
     }
-    int act(std::map<std::string, std::map<std::string, std::vector<double>>> &results, YAML::Node &agentYAMLNode) {
+    int act(EpisodeMetrics::AgentMetrics metrics, YAML::Node &agentYAMLNode) {
       return GridTrafficSimple2AtomicAgentSimulator::step(_AOH.begin());
     }
     virtual void observe(int &observation) {
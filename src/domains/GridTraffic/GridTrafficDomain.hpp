@@ -5,6 +5,7 @@
 #include "agents/PlanningAgent.hpp"
 #include "Utils.hpp"
 #include "GridTrafficAtomicAgent.hpp"
+#include <functional>
 
 class GridTrafficDomain: public Domain {
 
@@ -13,18 +14,205 @@ class GridTrafficDomain: public Domain {
 
   public:
     
-    GridTrafficDomain(const YAML::Node &parameters) : Domain(parameters) {
+    GridTrafficDomain(const YAML::Node &parameters) : Domain(withGeneratedNetwork(parameters, generateNetwork)) {
       _obsLength = parameters["GridTraffic"]["obsLength"].as<int>();
+      if (parameters["GridTraffic"]["native"].IsDefined() && parameters["GridTraffic"]["native"].as<bool>() == true) {
+        _usesNativeModel = buildNativeModel();
+        if (_usesNativeModel == true) {
+          LOG(INFO) << "Simulators of GridTraffic step the native model of " << _roads.size() << " roads and " << _intersections.size() << " intersections.";
+        } else {
+          LOG(WARNING) << "The DBN does not have the structure of GridTraffic, simulators step the DBN.";
+        }
+      }
+    }
+
+    // the network of a grid of intersections, numbered row by row. horizontal roads h1, h2, ... run along the rows and vertical roads v1, v2, ...
+    // along the columns, every intersection passed adds two stretches of laneLength cells with the light in between. generated from
+    // GridTraffic:
+    //   obsLength: 1                # cells observed in front of and behind every light
+    //   generate:
+    //     numberOfRows: 3           # or numberOfAgents, for the most square grid with at least that many intersections
+    //     numberOfColumns: 3
+    //     laneLength: 6
+    //     inflowProbability: 1.0
+    //     outflowProbability: 0.3
+    //     observationNoise: 0.0
+    //     initialProbability: 0.7   # probability that a cell holds a car initially
+    static YAML::Node generateNetwork(const YAML::Node &domainParameters) {
+      const YAML::Node &generatorParameters = domainParameters["generate"];
+      int numberOfRows, numberOfColumns;
+      if (generatorParameters["numberOfRows"].IsDefined()) {
+        numberOfRows = generatorParameters["numberOfRows"].as<int>();
+        numberOfColumns = generatorParameters["numberOfColumns"].as<int>();
+      } else {
+        int numberOfAgents = generatorParameters["numberOfAgents"].as<int>();
+        numberOfRows = std::max(1, (int)std::floor(std::sqrt((double)numberOfAgents)));
+        numberOfColumns = (numberOfAgents + numberOfRows - 1) / numberOfRows;
+      }
+      int laneLength = generatorParameters["laneLength"].IsDefined() ? generatorParameters["laneLength"].as<int>() : 6;
+      double inflowProbability = generatorParameters["inflowProbability"].IsDefined() ? generatorParameters["inflowProbability"].as<double>() : 1.0;
+      double outflowProbability = generatorParameters["outflowProbability"].IsDefined() ? generatorParameters["outflowProbability"].as<double>() : 0.3;
+      double observationNoise = generatorParameters["observationNoise"].IsDefined() ? generatorParameters["observationNoise"].as<double>() : 0.0;
+      double initialProbability = generatorParameters["initialProbability"].IsDefined() ? generatorParameters["initialProbability"].as<double>() : 0.7;
+      int obsLength = domainParameters["obsLength"].as<int>();
+      if (numberOfRows < 1 || numberOfColumns < 1 || laneLength < 2 || obsLength < 1 || obsLength > laneLength) {
+        throw std::invalid_argument("GridTraffic needs at least one intersection, lanes of at least two cells and obsLength between 1 and laneLength.");
+      }
+
+      YAML::Node network;
+      for (int k=1; k<=numberOfRows*numberOfColumns; k++) {
+        network.force_insert("a" + std::to_string(k), makeNetworkVariable({}, {}, {0, 1}));
+      }
+      // the light of a road turns green for horizontal roads with action 0 and for vertical roads with action 1
+      std::vector<std::vector<std::string>> observedCells(numberOfRows*numberOfColumns), rewardedCells(numberOfRows*numberOfColumns);
+      for (int greenAction=0; greenAction<=1; greenAction++) {
+        int numberOfRoads = greenAction == 0 ? numberOfRows : numberOfColumns;
+        int numberOfBlocks = greenAction == 0 ? numberOfColumns : numberOfRows;
+        int length = 2 * laneLength * numberOfBlocks;
+        for (int road=0; road<=numberOfRoads-1; road++) {
+          std::string roadName = (greenAction == 0 ? "h" : "v") + std::to_string(road+1);
+          for (int i=0; i<=length-1; i++) {
+            std::string name = getCellName(roadName, i);
+            std::string previous = i > 0 ? getCellName(roadName, i-1) : "";
+            std::string next = i < length-1 ? getCellName(roadName, i+1) : "";
+            int block = i / (2 * laneLength);
+            int agent = greenAction == 0 ? road * numberOfColumns + block : block * numberOfColumns + road;
+            std::string actionName = "a" + std::to_string(agent+1);
+            YAML::Node cell = makeNetworkVariable({}, {}, {0, 1});
+            cell["initial_dist"] = std::vector<double>{1.0 - initialProbability, initialProbability};
+            network.force_insert(name, cell);
+            // the probability that the cell holds a car after the step
+            std::function<double(const std::vector<int>&)> rule;
+            std::vector<std::string> parents;
+            if (i == 0) {
+              parents = {name, next};
+              rule = [&](const std::vector<int> &v) { return v[0] == 1 ? (double)v[1] : inflowProbability; };
+            } else if (i == length-1) {
+              parents = {previous, name};
+              rule = [&](const std::vector<int> &v) { return v[1] == 1 ? 1.0 - outflowProbability : (double)v[0]; };
+            } else if (i % (2 * laneLength) == laneLength-1) {
+              parents = {previous, name, actionName, next};
+              rule = [&](const std::vector<int> &v) { return v[1] == 1 ? (double)(v[3] == 1 || v[2] != greenAction) : (double)v[0]; };
+            } else if (i % (2 * laneLength) == laneLength) {
+              parents = {previous, actionName, name, next};
+              rule = [&](const std::vector<int> &v) { return v[2] == 1 ? (double)v[3] : (double)(v[0] == 1 && v[1] == greenAction); };
+            } else {
+              parents = {previous, name, next};
+              rule = [&](const std::vector<int> &v) { return v[1] == 1 ? (double)v[2] : (double)v[0]; };
+            }
+            network.force_insert(name + "'", makeNetworkVariable(parents, std::vector<int>(parents.size(), 2), {0, 1}, [&](const std::vector<int> &v) {
+              double probability = rule(v);
+              return std::vector<double>{1.0 - probability, probability};
+            }));
+            int offset = i % (2 * laneLength);
+            if (offset >= laneLength - obsLength && offset < laneLength + obsLength) {
+              observedCells[agent].push_back(name + "'");
+            }
+            rewardedCells[agent].push_back(name + "'");
+          }
+        }
+      }
+      for (int k=0; k<=numberOfRows*numberOfColumns-1; k++) {
+        std::string ID = std::to_string(k+1);
+        YAML::Node observation = makeNetworkVariable(observedCells[k], {}, rangeOfValues(1 << observedCells[k].size()));
+        observation["mode"] = "NOISYEXPSUM";
+        observation["NOISYEXPSUM"]["base"] = 2;
+        observation["NOISYEXPSUM"]["noise"] = observationNoise;
+        network.force_insert("o" + ID, observation);
+        std::vector<int> rewards = rangeOfValues(rewardedCells[k].size() + 1);
+        std::transform(rewards.begin(), rewards.end(), rewards.begin(), std::negate<int>());
+        YAML::Node reward = makeNetworkVariable(rewardedCells[k], {}, rewards);
+        reward["mode"] = "SUM";
+        network.force_insert("r" + ID, reward);
+      }
+      return network;
+    }
+
+    // every road is a lane of cells, stored as bits. a car moves on when the next cell is empty and, in front of a traffic light, the light is green.
+    // cars enter an empty first cell with the inflow probability of the road and leave the last cell with its outflow probability
+    void stepGlobal(std::vector<int> &environmentState, SimulationContext &context) {
+      if (_usesNativeModel == false) {
+        Domain::stepGlobal(environmentState, context);
+        return;
+      }
+      if ((int)context.bitsets.size() < _numberOfWords + 2 * _maximumNumberOfWords) {
+        context.bitsets.resize(_numberOfWords + 2 * _maximumNumberOfWords);
+      }
+      uint64_t *cells = context.bitsets.data();
+      uint64_t *blocked = cells + _numberOfWords;
+      uint64_t *moving = blocked + _maximumNumberOfWords;
+      std::default_random_engine &randomNumberGenerator = context.randomNumberGenerator;
+      for (auto &lane: _roads) {
+        uint64_t *laneCells = cells + lane.wordOffset;
+        std::fill(laneCells, laneCells + lane.numberOfWords, 0);
+        for (int i=0; i<=lane.numberOfCells-1; i++) {
+          laneCells[i >> 6] |= (uint64_t)(environmentState[lane.stateIndices[i]] & 1) << (i & 63);
+        }
+        std::fill(blocked, blocked + lane.numberOfWords, 0);
+        for (auto &gate: lane.gates) {
+          blocked[gate.cell >> 6] |= (uint64_t)(environmentState[gate.actionIndex] != gate.greenAction) << (gate.cell & 63);
+        }
+        bool inflow = getCell(laneCells, 0) == 0 && bernoulli(lane.inflowThreshold, randomNumberGenerator);
+        bool outflow = getCell(laneCells, lane.numberOfCells-1) == 1 && bernoulli(lane.outflowThreshold, randomNumberGenerator);
+        stepLane(laneCells, lane.numberOfWords, lane.numberOfCells, blocked, moving, inflow, outflow);
+        for (int i=0; i<=lane.numberOfCells-1; i++) {
+          int cell = getCell(laneCells, i);
+          environmentState[lane.nextStateIndices[i]] = cell;
+          environmentState[lane.stateIndices[i]] = cell;
+        }
+      }
+      for (auto &intersection: _intersections) {
+        environmentState[intersection.observationIndex] = observe(intersection.globalCells, cells, intersection.noiseThreshold, randomNumberGenerator);
+        environmentState[intersection.rewardIndex] = countCars(intersection.globalCells, cells);
+      }
+    }
+
+    // the lanes of the local model are the parts of the roads in the local state, the cells around them are influence sources
+    void stepLocal(const std::string &agentID, std::map<std::string, int> &environmentState, SimulationContext &context) {
+      if (_usesNativeModel == false) {
+        Domain::stepLocal(agentID, environmentState, context);
+        return;
+      }
+      const Intersection &intersection = _intersections[_indicesOfIntersections.at(agentID)];
+      if ((int)context.bitsets.size() < intersection.numberOfLocalWords + 2 * _maximumNumberOfWords) {
+        context.bitsets.resize(intersection.numberOfLocalWords + 2 * _maximumNumberOfWords);
+      }
+      uint64_t *cells = context.bitsets.data();
+      uint64_t *blocked = cells + intersection.numberOfLocalWords;
+      uint64_t *moving = blocked + _maximumNumberOfWords;
+      std::default_random_engine &randomNumberGenerator = context.randomNumberGenerator;
+      for (auto &lane: intersection.localLanes) {
+        uint64_t *laneCells = cells + lane.wordOffset;
+        std::fill(laneCells, laneCells + lane.numberOfWords, 0);
+        for (int i=0; i<=lane.numberOfCells-1; i++) {
+          laneCells[i >> 6] |= (uint64_t)(environmentState.at(lane.stateNames[i]) & 1) << (i & 63);
+        }
+        std::fill(blocked, blocked + lane.numberOfWords, 0);
+        for (auto &gate: lane.gates) {
+          blocked[gate.cell >> 6] |= (uint64_t)(environmentState.at(gate.actionName) != gate.greenAction) << (gate.cell & 63);
+        }
+        bool inflow = getCell(laneCells, 0) == 0 && (lane.previousCellName.empty() ? bernoulli(lane.inflowThreshold, randomNumberGenerator) : environmentState.at(lane.previousCellName) == 1);
+        bool outflow = getCell(laneCells, lane.numberOfCells-1) == 1 && (lane.nextCellName.empty() ? bernoulli(lane.outflowThreshold, randomNumberGenerator) : environmentState.at(lane.nextCellName) == 0);
+        stepLane(laneCells, lane.numberOfWords, lane.numberOfCells, blocked, moving, inflow, outflow);
+        for (int i=0; i<=lane.numberOfCells-1; i++) {
+          int cell = getCell(laneCells, i);
+          environmentState[lane.nextStateNames[i]] = cell;
+          environmentState[lane.stateNames[i]] = cell;
+        }
+      }
+      environmentState[intersection.observationName] = observe(intersection.localCells, cells, intersection.noiseThreshold, randomNumberGenerator);
+      environmentState[intersection.rewardName] = countCars(intersection.localCells, cells);
     }
     
     AtomicAgentSimulator *makeAtomicAgentSimulator(const std::string &agentID, const std::string &agentType) {
-      AtomicAgentSimulator *agentSimulatorPtr;
+      AtomicAgentSimulator *agentSimulatorPtr = nullptr;
       if (agentType == "Random") {
         agentSimulatorPtr = new RandomAtomicAgentSimulator(_numberOfActions[agentID]);
       } else if (agentType == "Simple2") {
         agentSimulatorPtr = new GridTrafficSimple2AtomicAgentSimulator(_obsLength);
       } else {
-        LOG(FATAL) << "Agent type " << agentType << " not supported.";
+        std::string message = "Agent type " + agentType + " is not supported.";
+        throw std::invalid_argument(message);
       }
       return agentSimulatorPtr;
     }
@@ -43,7 +231,7 @@ class GridTrafficDomain: public Domain {
       } else if (agentType == "POMCP") {
         std::string simulatorType = thisAgentParameters["Simulator"]["Type"].as<std::string>();
         if (simulatorType == "Global") {
-          atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentGlobalSimulatorState>(
+          atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentGlobalSimulatorState, Domain::SingleAgentGlobalSimulator>(
             agentID, 
             _numberOfActions[agentID], 
             _numberOfStepsToPlan, 
@@ -58,7 +246,7 @@ class GridTrafficDomain: public Domain {
         } else if (simulatorType == "Local") {
           bool recurrent = thisAgentParameters["Simulator"]["InfluencePredictor"]["recurrent"].as<bool>();
           if (recurrent == false) {
-            atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentSequentialInfluenceAugmentedSimulatorState>(
+            atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentSequentialInfluenceAugmentedSimulatorState, Domain::SingleAgentSequentialInfluenceAugmentedSimulator>(
               agentID, 
               _numberOfActions[agentID], 
               _numberOfStepsToPlan, 
@@ -71,31 +259,345 @@ class GridTrafficDomain: public Domain {
               )
             );
           } else {
-            atomicAgentPtr = new POMCPAtomicAgent<Domain::SingleAgentRecurrentInfluenceAugmentedSimulatorState>(
+            atomicAgentPtr = makeRecurrentInfluenceAugmentedPOMCPAtomicAgent(
               agentID, 
               _numberOfActions[agentID], 
               _numberOfStepsToPlan, 
               _discountFactor,
               thisAgentParameters,
-              new Domain::SingleAgentRecurrentInfluenceAugmentedSimulator(
-                agentID, 
-                this, 
-                thisAgentParameters["Simulator"]
-              )
+              this
             );
           }
         } else {
           std::string message = "Unsupported simulator type: " + simulatorType + ".";
-          LOG(FATAL) << message;
-          return nullptr;
+          throw std::invalid_argument(message);
         }
       } else {
         std::string message = "Agent Type " + agentType + " is not supported.";
-        LOG(FATAL) << message;
-        atomicAgentPtr == nullptr;
+        throw std::invalid_argument(message);
       }
       return atomicAgentPtr;
     }
+
+  private:
+    // a light in front of which cars wait while it is red
+    struct Gate {
+      int cell; // relative to the first cell of the lane
+      int actionIndex;
+      std::string actionName;
+      int greenAction;
+    };
+    // a road, or a part of a road in a local model, with the indices of its cells in the dense state and their names in local states
+    struct Lane {
+      int numberOfCells;
+      int wordOffset; // where the cells of the lane start in the words of the model
+      int numberOfWords;
+      std::vector<int> stateIndices;
+      std::vector<int> nextStateIndices;
+      std::vector<std::string> stateNames;
+      std::vector<std::string> nextStateNames;
+      std::vector<Gate> gates;
+      std::string previousCellName; // the cell before a part of a road, empty at the start of the road
+      std::string nextCellName; // the cell after a part of a road, empty at the end of the road
+      uint64_t inflowThreshold;
+      uint64_t outflowThreshold;
+    };
+    // the cells an intersection observes and is rewarded for, as bits in the words of the model
+    struct CellLayout {
+      std::vector<int> observedBits;
+      std::vector<std::pair<int, uint64_t>> rewardMasks; // words and the cells counted in them
+    };
+    struct Intersection {
+      int observationIndex;
+      int rewardIndex;
+      std::string observationName;
+      std::string rewardName;
+      uint64_t noiseThreshold; // the probability that an observed cell is flipped
+      CellLayout globalCells;
+      std::vector<Lane> localLanes;
+      CellLayout localCells;
+      int numberOfLocalWords;
+    };
+    std::vector<Lane> _roads;
+    std::vector<Intersection> _intersections;
+    std::map<std::string, int> _indicesOfIntersections;
+    int _numberOfWords = 0;
+    int _maximumNumberOfWords = 0;
+
+    static int getCell(const uint64_t *cells, int i) {
+      return (cells[i >> 6] >> (i & 63)) & 1;
+    }
+
+    // one step of a lane, cell i is bit i. inflow: a car enters the first cell, which is empty. outflow: the car in the last cell leaves
+    static void stepLane(uint64_t *cells, int numberOfWords, int numberOfCells, const uint64_t *blocked, uint64_t *moving, bool inflow, bool outflow) {
+      int last = numberOfCells - 1;
+      for (int w=0; w<=numberOfWords-1; w++) {
+        uint64_t nextCells = (cells[w] >> 1) | (w == numberOfWords-1 ? 0 : cells[w+1] << 63);
+        moving[w] = cells[w] & ~nextCells & ~blocked[w];
+      }
+      if (outflow == false) {
+        moving[last >> 6] &= ~((uint64_t)1 << (last & 63));
+      }
+      uint64_t carry = 0;
+      for (int w=0; w<=numberOfWords-1; w++) {
+        uint64_t movedIn = (moving[w] << 1) | carry;
+        carry = moving[w] >> 63;
+        cells[w] = (cells[w] & ~moving[w]) | movedIn;
+      }
+      // drop the car that moved past the last cell
+      if ((last & 63) != 63) {
+        cells[last >> 6] &= ((uint64_t)1 << ((last & 63) + 1)) - 1;
+      }
+      cells[0] |= (uint64_t)inflow;
+    }
+
+    int observe(const CellLayout &layout, const uint64_t *cells, uint64_t noiseThreshold, std::default_random_engine &randomNumberGenerator) {
+      int observation = 0;
+      for (int i=0; i<=(int)layout.observedBits.size()-1; i++) {
+        observation |= (getCell(cells, layout.observedBits[i]) ^ bernoulli(noiseThreshold, randomNumberGenerator)) << i;
+      }
+      return observation;
+    }
+
+    int countCars(const CellLayout &layout, const uint64_t *cells) {
+      int numberOfCars = 0;
+      for (auto &[word, mask]: layout.rewardMasks) {
+        numberOfCars += __builtin_popcountll(cells[word] & mask);
+      }
+      return numberOfCars;
+    }
+
+    // whether the CPT of a binary variable with binary parents gives the probability of 1 of the rule for every value of the parents
+    static bool matchesRule(TwoStageDynamicBayesianNetworkVariable *variablePtr, const std::function<double(const std::vector<int>&)> &rule) {
+      int numberOfParents = variablePtr->getNumberOfInputs();
+      if (variablePtr->getMode() != CPT || variablePtr->getNumberOfValues() != 2) {
+        return false;
+      }
+      std::vector<int> parentValues(numberOfParents);
+      for (int combination=0; combination<=(1 << numberOfParents)-1; combination++) {
+        for (int i=0; i<=numberOfParents-1; i++) {
+          parentValues[i] = (combination >> (numberOfParents-1-i)) & 1;
+        }
+        try {
+          if (std::abs(variablePtr->getConditionalProbabilities(parentValues)[1] - rule(parentValues)) > 1e-6) {
+            return false;
+          }
+        } catch (const std::out_of_range &e) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    static std::string getCellName(const std::string &road, int cell) {
+      return "x_" + road + "_" + std::to_string(cell+1);
+    }
+
+    // add the cells that an intersection observes and is rewarded for, found by name in the given lanes
+    bool layOutCells(const std::vector<std::string> &observedCells, const std::vector<std::string> &rewardedCells, const std::map<std::string, int> &bitsOfCells, CellLayout &layout) {
+      for (auto &name: observedCells) {
+        if (bitsOfCells.count(name) == 0) {
+          return false;
+        }
+        layout.observedBits.push_back(bitsOfCells.at(name));
+      }
+      std::map<int, uint64_t> rewardMasks;
+      for (auto &name: rewardedCells) {
+        if (bitsOfCells.count(name) == 0) {
+          return false;
+        }
+        int bit = bitsOfCells.at(name);
+        rewardMasks[bit >> 6] |= (uint64_t)1 << (bit & 63);
+      }
+      layout.rewardMasks.assign(rewardMasks.begin(), rewardMasks.end());
+      return true;
+    }
+
+    // read the roads, lights and probabilities from the DBN, false if the DBN is not a GridTraffic network
+    bool buildNativeModel() {
+      TwoStageDynamicBayesianNetwork *DBNPtr = _DBNPtr;
+      // cells are named x_<road>_<k> with k from 1 to the length of the road
+      std::map<std::string, int> lengthsOfRoads;
+      int numberOfCells = 0;
+      for (int index=0; index<=DBNPtr->getNumberOfVariables()-1; index++) {
+        std::string name = DBNPtr->getVariable(index)->name;
+        if (name[0] != 'x' || StringUtils::lastBitIsPrime(name) == true) {
+          continue;
+        }
+        size_t split = name.rfind('_');
+        if (name.rfind("x_", 0) != 0 || split <= 2 || split == name.size()-1 || name.find_first_not_of("0123456789", split+1) != std::string::npos) {
+          return false;
+        }
+        std::string road = name.substr(2, split-2);
+        lengthsOfRoads[road] = std::max(lengthsOfRoads[road], std::stoi(name.substr(split+1)));
+        numberOfCells += 1;
+      }
+      int lengthOfAllRoads = 0;
+      for (auto &[road, length]: lengthsOfRoads) {
+        lengthOfAllRoads += length;
+      }
+      // cells, next cells, actions, observations and rewards, nothing else
+      if (lengthOfAllRoads != numberOfCells || DBNPtr->getNumberOfVariables() != 2 * numberOfCells + 3 * (int)_numberOfActions.size()) {
+        return false;
+      }
+
+      // the rule of every cell
+      std::map<std::string, int> bitsOfCells;
+      std::set<std::string> gateCells;
+      for (auto &[road, length]: lengthsOfRoads) {
+        Lane lane;
+        lane.numberOfCells = length;
+        lane.wordOffset = _numberOfWords;
+        lane.numberOfWords = (length + 63) / 64;
+        if (length < 2) {
+          return false;
+        }
+        for (int i=0; i<=length-1; i++) {
+          std::string name = getCellName(road, i);
+          if (DBNPtr->hasVariable(name) == false || DBNPtr->hasVariable(name + "'") == false) {
+            return false;
+          }
+          lane.stateIndices.push_back(DBNPtr->getIndexOfVariable(name));
+          lane.nextStateIndices.push_back(DBNPtr->getIndexOfVariable(name + "'"));
+          lane.stateNames.push_back(name);
+          lane.nextStateNames.push_back(name + "'");
+          bitsOfCells[name] = 64 * lane.wordOffset + i;
+          TwoStageDynamicBayesianNetworkVariable *variablePtr = DBNPtr->getVariable(lane.nextStateIndices.back());
+          std::vector<std::string> parents = variablePtr->getListOfParents();
+          std::string previous = i > 0 ? getCellName(road, i-1) : "";
+          std::string next = i < length-1 ? getCellName(road, i+1) : "";
+          bool matched = false;
+          if (i == 0 && parents == std::vector<std::string>{name, next}) {
+            // the first cell, a car enters if it is empty
+            double inflowProbability = variablePtr->getConditionalProbabilities({0, 0})[1];
+            lane.inflowThreshold = toThreshold(inflowProbability);
+            matched = matchesRule(variablePtr, [&](const std::vector<int> &v) { return v[0] == 1 ? (double)v[1] : inflowProbability; });
+          } else if (i == length-1 && parents == std::vector<std::string>{previous, name}) {
+            // the last cell, its car leaves
+            double outflowProbability = 1.0 - variablePtr->getConditionalProbabilities({0, 1})[1];
+            lane.outflowThreshold = toThreshold(outflowProbability);
+            matched = matchesRule(variablePtr, [&](const std::vector<int> &v) { return v[1] == 1 ? 1.0 - outflowProbability : (double)v[0]; });
+          } else if (i > 0 && i < length-1 && parents == std::vector<std::string>{previous, name, next}) {
+            matched = matchesRule(variablePtr, [&](const std::vector<int> &v) { return v[1] == 1 ? (double)v[2] : (double)v[0]; });
+          } else if (i > 0 && i < length-1 && parents.size() == 4 && parents[0] == previous && parents[1] == name && parents[2][0] == 'a' && parents[3] == next) {
+            // in front of a light, the car waits while the light is red
+            for (int greenAction=0; greenAction<=1 && matched == false; greenAction++) {
+              matched = matchesRule(variablePtr, [&](const std::vector<int> &v) { return v[1] == 1 ? (double)(v[3] == 1 || v[2] != greenAction) : (double)v[0]; });
+              if (matched == true) {
+                lane.gates.push_back({i, DBNPtr->getIndexOfVariable(parents[2]), parents[2], greenAction});
+                gateCells.insert(name);
+              }
+            }
+          } else if (i > 1 && i < length-1 && parents.size() == 4 && parents[0] == previous && parents[2] == name && parents[3] == next && lane.gates.size() > 0 && lane.gates.back().cell == i-1 && lane.gates.back().actionName == parents[1]) {
+            // behind a light, a car comes in from the previous cell while the light is green
+            int greenAction = lane.gates.back().greenAction;
+            matched = matchesRule(variablePtr, [&](const std::vector<int> &v) { return v[2] == 1 ? (double)v[3] : (double)(v[0] == 1 && v[1] == greenAction); });
+          }
+          if (matched == false) {
+            return false;
+          }
+        }
+        _numberOfWords += lane.numberOfWords;
+        _maximumNumberOfWords = std::max(_maximumNumberOfWords, lane.numberOfWords);
+        _roads.push_back(lane);
+      }
+
+      // intersections observe noisy cells in front of and behind their lights and are rewarded for the cars on their parts of the roads
+      for (auto &[agentID, numberOfActions]: _numberOfActions) {
+        Intersection intersection;
+        intersection.observationName = "o" + agentID;
+        intersection.rewardName = "r" + agentID;
+        if (numberOfActions != 2 || DBNPtr->hasVariable(intersection.observationName) == false || DBNPtr->hasVariable(intersection.rewardName) == false) {
+          return false;
+        }
+        intersection.observationIndex = DBNPtr->getIndexOfVariable(intersection.observationName);
+        intersection.rewardIndex = DBNPtr->getIndexOfVariable(intersection.rewardName);
+        TwoStageDynamicBayesianNetworkVariable *observationPtr = DBNPtr->getVariable(intersection.observationIndex);
+        TwoStageDynamicBayesianNetworkVariable *rewardPtr = DBNPtr->getVariable(intersection.rewardIndex);
+        if (observationPtr->getMode() != NOISYEXPSUM || observationPtr->getExpSumBase() != 2 || rewardPtr->getMode() != SUM) {
+          return false;
+        }
+        // the observation noise flips a cell when a draw from 0, 0.1, ..., 0.9 is below it
+        int numberOfFlips = 0;
+        for (int k=0; k<=9; k++) {
+          float r = 1.0 * k / 10;
+          numberOfFlips += (r < observationPtr->getNoise());
+        }
+        intersection.noiseThreshold = toThreshold(numberOfFlips / 10.0);
+        std::vector<std::string> observedCells;
+        std::vector<std::string> rewardedCells;
+        for (auto &parentName: observationPtr->getListOfParents()) {
+          observedCells.push_back(StringUtils::removeLastPrime(parentName));
+        }
+        for (auto &parentName: rewardPtr->getListOfParents()) {
+          rewardedCells.push_back(StringUtils::removeLastPrime(parentName));
+        }
+        for (auto &parentNames: {observationPtr->getListOfParents(), rewardPtr->getListOfParents()}) {
+          for (auto &parentName: parentNames) {
+            if (StringUtils::lastBitIsPrime(parentName) == false || bitsOfCells.count(StringUtils::removeLastPrime(parentName)) == 0) {
+              return false;
+            }
+          }
+        }
+        if (layOutCells(observedCells, rewardedCells, bitsOfCells, intersection.globalCells) == false) {
+          return false;
+        }
+
+        // the local lanes are the runs of observed and rewarded cells along every road
+        std::set<std::string> localCells(observedCells.begin(), observedCells.end());
+        localCells.insert(rewardedCells.begin(), rewardedCells.end());
+        std::map<std::string, int> localBitsOfCells;
+        int numberOfLocalWords = 0;
+        for (int r=0; r<=(int)_roads.size()-1; r++) {
+          const Lane &road = _roads[r];
+          int i = 0;
+          while (i <= road.numberOfCells-1) {
+            if (localCells.count(road.stateNames[i]) == 0) {
+              i += 1;
+              continue;
+            }
+            int first = i;
+            while (i <= road.numberOfCells-1 && localCells.count(road.stateNames[i]) != 0) {
+              i += 1;
+            }
+            Lane lane;
+            lane.numberOfCells = i - first;
+            lane.wordOffset = numberOfLocalWords;
+            lane.numberOfWords = (lane.numberOfCells + 63) / 64;
+            lane.stateNames.assign(road.stateNames.begin()+first, road.stateNames.begin()+i);
+            lane.nextStateNames.assign(road.nextStateNames.begin()+first, road.nextStateNames.begin()+i);
+            lane.previousCellName = first > 0 ? road.stateNames[first-1] : "";
+            lane.nextCellName = i < road.numberOfCells ? road.stateNames[i] : "";
+            lane.inflowThreshold = road.inflowThreshold;
+            lane.outflowThreshold = road.outflowThreshold;
+            // the influence sources are other cells, the lights are the agent's own
+            if (gateCells.count(lane.previousCellName) != 0) {
+              return false;
+            }
+            for (auto &gate: road.gates) {
+              if (gate.cell >= first && gate.cell < i) {
+                if (gate.actionName != "a" + agentID) {
+                  return false;
+                }
+                lane.gates.push_back({gate.cell - first, gate.actionIndex, gate.actionName, gate.greenAction});
+              }
+            }
+            for (int k=0; k<=lane.numberOfCells-1; k++) {
+              localBitsOfCells[lane.stateNames[k]] = 64 * lane.wordOffset + k;
+            }
+            numberOfLocalWords += lane.numberOfWords;
+            intersection.localLanes.push_back(lane);
+          }
+        }
+        intersection.numberOfLocalWords = numberOfLocalWords;
+        if (layOutCells(observedCells, rewardedCells, localBitsOfCells, intersection.localCells) == false) {
+          return false;
+        }
+        _indicesOfIntersections[agentID] = _intersections.size();
+        _intersections.push_back(intersection);
+      }
+      return true;
+    }
 };
 
 #endif
\ No newline at end of file
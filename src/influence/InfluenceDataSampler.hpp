@@ -0,0 +1,97 @@
+#ifndef INFLUENCE_DATA_SAMPLER_HPP_
+#define INFLUENCE_DATA_SAMPLER_HPP_
+
+#include "domains/Domain.hpp"
+
+// samples the training data of the influence predictor of an agent from the global simulator, with random actions of the agent
+// the inputs of every step are the local states followed by the action of the agent, the outputs are the influence sources
+class InfluenceDataSampler {
+  public:
+    InfluenceDataSampler(const std::string &agentID, Domain *domainPtr, Domain::SingleAgentGlobalSimulator *globalSimulatorPtr): _globalSimulatorPtr(globalSimulatorPtr) {
+      _numberOfActions = domainPtr->getAgentsSpecification()[agentID];
+      std::vector<std::string> destinationFactors;
+      domainPtr->getDBNPtr()->constructLocalModel(agentID, _localFactors, _localStates, _influenceSources, destinationFactors, _inputs);
+      // indices of the local states and influence sources in the dense state of the global simulator
+      for (auto &varName: _localStates) {
+        _localStateIndices.push_back(domainPtr->getDBNPtr()->getIndexOfVariable(varName));
+      }
+      for (auto &varName: _influenceSources) {
+        _influenceSourceIndices.push_back(domainPtr->getDBNPtr()->getIndexOfVariable(varName));
+      }
+    }
+
+    std::vector<std::string> &getLocalFactors() {
+      return _localFactors;
+    }
+
+    std::vector<std::string> &getInputs() {
+      return _inputs;
+    }
+
+    std::vector<std::string> &getOutputs() {
+      return _influenceSources;
+    }
+
+    // fills inputs and outputs of numberOfEpisodes x horizon-1 x the number of inputs or outputs, in row major order
+    void sample(int numberOfEpisodes, int horizon, int *inputs, int *outputs, Domain::SimulationContext &context) {
+      int sizeOfInputs = _inputs.size();
+      int sizeOfOutputs = _influenceSources.size();
+      auto input = [&](int i, int step, int j) -> int& {
+        return inputs[((long)i*(horizon-1)+step)*sizeOfInputs+j];
+      };
+      auto output = [&](int i, int step, int j) -> int& {
+        return outputs[((long)i*(horizon-1)+step)*sizeOfOutputs+j];
+      };
+      int observation;
+      float reward;
+      bool done;
+      for (int i=0; i<=numberOfEpisodes-1; i++) {
+        // sample one state
+        auto state = _globalSimulatorPtr->sampleInitialState(context);
+        // do the trajectory simulation
+        for (int step=0; step<=horizon-1; step++) {
+          int action = RandomUtils::randint(0, _numberOfActions-1);
+          _globalSimulatorPtr->step(state, action, observation, reward, done, context);
+
+          if (step <= horizon-2) {
+            // extract local states and actions and influence sources
+            for (int j=0; j<=(int)_localStates.size()-1; j++){
+              input(i, step, j) = state.environmentState[_localStateIndices[j]];
+            }
+            input(i, step, _localStates.size()) = action;
+            // outputs
+            for (int j=0; j<=sizeOfOutputs-1; j++) {
+              if (_influenceSources.at(j)[0] != 'a') {
+                output(i, step, j) = state.environmentState[_influenceSourceIndices[j]];
+              } else {
+                if (step != 0) {
+                  output(i, step-1, j) = state.environmentState[_influenceSourceIndices[j]];
+                }
+              }
+            }
+          } else if (step != 0) {
+            // the actions of the last step are the sources of the step before
+            for (int j=0; j<=sizeOfOutputs-1; j++) {
+              if (_influenceSources.at(j)[0] == 'a') {
+                output(i, step-1, j) = state.environmentState[_influenceSourceIndices[j]];
+              }
+            }
+          }
+        }
+        // no state of the episode is left, so the context releases what its states used
+        _globalSimulatorPtr->releaseContext([](std::vector<Domain::SingleAgentGlobalSimulatorState*> &states) {}, context);
+      }
+    }
+
+  private:
+    Domain::SingleAgentGlobalSimulator *_globalSimulatorPtr;
+    int _numberOfActions;
+    std::vector<std::string> _localFactors;
+    std::vector<std::string> _localStates;
+    std::vector<std::string> _influenceSources;
+    std::vector<std::string> _inputs;
+    std::vector<int> _localStateIndices;
+    std::vector<int> _influenceSourceIndices;
+};
+
+#endif
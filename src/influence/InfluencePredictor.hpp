@@ -7,15 +7,26 @@
 #include "Utils.hpp"
 #include "glog/logging.h"
 #include <ctime>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 // general influence predictor
+// predictors are not modified by sampling, the random number generator is passed in by the simulation context
 class InfluencePredictor {
   public:
     InfluencePredictor(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables): _netPtr(netPtr), _localStatesAndActions(localStatesAndActions), _influenceSourceVariables(influenceSourceVariables) {
       
     }
-    virtual void sample(std::vector<int> &inputs, std::map<std::string, int> &dict) = 0;
-    virtual void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict) {};
+    virtual ~InfluencePredictor() {}
+    virtual void sample(std::vector<int> &inputs, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) = 0;
+    virtual void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {};
     virtual std::vector<float> getInitialState() { return std::vector<float>(); };
   protected:
     TwoStageDynamicBayesianNetwork *_netPtr;
@@ -30,25 +41,39 @@ class RandomInfluencePredictor: public InfluencePredictor  {
     RandomInfluencePredictor(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables): InfluencePredictor(netPtr, localStatesAndActions, influenceSourceVariables) {
       LOG(INFO) << "Random influence predictor has been constructed.";
     }
-    void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict) {
+    void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {
       for (auto &factorName: _influenceSourceVariables) {
-        dict[factorName] = (_netPtr->getVariable(factorName))->sampleUniformly();
+        dict[factorName] = (_netPtr->getVariable(factorName))->sampleUniformly(randomNumberGenerator);
       }
     }
-    void sample(std::vector<int> &inputs, std::map<std::string, int> &dict) {
+    void sample(std::vector<int> &inputs, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {
       for (auto &factorName: _influenceSourceVariables) {
-        dict[factorName] = (_netPtr->getVariable(factorName))->sampleUniformly();
+        dict[factorName] = (_netPtr->getVariable(factorName))->sampleUniformly(randomNumberGenerator);
       }
     }
 };
 
+// the immutable part of a trained recurrent influence predictor
+// loaded once per model file and shared by all predictors (and thus all planners) in the process
+struct RecurrentInfluenceModel {
+  torch::jit::script::Module module;
+  std::map<std::string, torch::Tensor> parameters; // weights prepared for the one step forward pass
+};
+
 class RecurrentInfluencePredictor: public InfluencePredictor {
   public:
-    RecurrentInfluencePredictor(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables, std::string modelPath, int numberOfHiddenStates): InfluencePredictor(netPtr, localStatesAndActions, influenceSourceVariables) {
-      // load the trained model
-      _model = torch::jit::load(modelPath);
-      _model.eval();
-      LOG(INFO) << "model has been loaded.";
+    RecurrentInfluencePredictor(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables, std::string modelPath, int numberOfHiddenStates, const std::string &core, const std::function<void(RecurrentInfluenceModel &, int)> &prepareParameters): InfluencePredictor(netPtr, localStatesAndActions, influenceSourceVariables) {
+      // load the trained model, or share it if another predictor has already loaded it
+      _sharedModelPtr = SharedResourceRegistry<RecurrentInfluenceModel>::get(core + ":" + std::to_string(numberOfHiddenStates) + ":" + FileUtils::versionedPath(modelPath), [&]() {
+        RecurrentInfluenceModel *modelPtr = new RecurrentInfluenceModel();
+        modelPtr->module = torch::jit::load(modelPath);
+        modelPtr->module.eval();
+        prepareParameters(*modelPtr, numberOfHiddenStates);
+        LOG(INFO) << "model " << modelPath << " has been loaded.";
+        return modelPtr;
+      });
+      // module handles are shallow, the weights are not copied
+      _model = _sharedModelPtr->module;
       _numberOfHiddenStates = numberOfHiddenStates;
       _totalOutputSize = 0;
       for (auto &key: influenceSourceVariables) {
@@ -57,9 +82,9 @@ class RecurrentInfluencePredictor: public InfluencePredictor {
         _totalOutputSize += numberOfValues;
       }
     }
-    virtual void sample(std::vector<int> &inputs, std::map<std::string, int> &dict) = 0;
+    virtual void sample(std::vector<int> &inputs, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) = 0;
 
-    virtual  void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict) = 0;
+    virtual  void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) = 0;
 
     std::vector<float> getInitialState() {
       std::vector<float> initialState;
@@ -70,54 +95,73 @@ class RecurrentInfluencePredictor: public InfluencePredictor {
     }
 
   protected:
+    std::shared_ptr<const RecurrentInfluenceModel> _sharedModelPtr;
     torch::jit::script::Module _model;
     c10::TensorOptions _options = torch::TensorOptions().dtype(torch::kFloat32);
     c10::TensorOptions _intOptions = torch::TensorOptions().dtype(torch::kInt32);
     int _numberOfHiddenStates;
     std::map<std::string, int> _map;
     int _totalOutputSize;
-    std::default_random_engine *_randomNumberGeneratorPtr;
 };
 
 // RNN based influence predictor
 class GRUInfluencePredictor: public RecurrentInfluencePredictor {
   public:
-    GRUInfluencePredictor(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables, std::string modelPath, int numberOfHiddenStates, bool fast=true): RecurrentInfluencePredictor(netPtr, localStatesAndActions, influenceSourceVariables, modelPath, numberOfHiddenStates) {
+    GRUInfluencePredictor(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables, std::string modelPath, int numberOfHiddenStates, bool fast=true): RecurrentInfluencePredictor(netPtr, localStatesAndActions, influenceSourceVariables, modelPath, numberOfHiddenStates, "GRU", prepareParameters) {
 
       _fast = fast;
       if (_fast == true) {
-        for (const auto &pair: _model.named_parameters()) {
-          if (pair.name == "gru.weight_ih_l0") {
-            wxr = pair.value.index({torch::indexing::Slice(0,1*_numberOfHiddenStates)}).clone().transpose_(0,1);
-            wxz = pair.value.index({torch::indexing::Slice(1*_numberOfHiddenStates,2*_numberOfHiddenStates)}).clone().transpose_(0,1);
-            wxn = pair.value.index({torch::indexing::Slice(2*_numberOfHiddenStates,3*_numberOfHiddenStates)}).clone().transpose_(0,1);
-          } else if (pair.name == "gru.weight_hh_l0") {
-            whr = pair.value.index({torch::indexing::Slice(0,1*_numberOfHiddenStates)}).clone().transpose_(0,1);
-            whz = pair.value.index({torch::indexing::Slice(1*_numberOfHiddenStates,2*_numberOfHiddenStates)}).clone().transpose_(0,1);
-            whn = pair.value.index({torch::indexing::Slice(2*_numberOfHiddenStates,3*_numberOfHiddenStates)}).clone().transpose_(0,1);
-          } else if (pair.name == "gru.bias_ih_l0") {
-            bxr = pair.value.index({torch::indexing::Slice(0,1*_numberOfHiddenStates)}).clone();
-            bxz = pair.value.index({torch::indexing::Slice(1*_numberOfHiddenStates,2*_numberOfHiddenStates)}).clone();
-            bxn = pair.value.index({torch::indexing::Slice(2*_numberOfHiddenStates,3*_numberOfHiddenStates)}).clone();
-          } else if (pair.name == "gru.bias_hh_l0") {
-            bhr = pair.value.index({torch::indexing::Slice(0*_numberOfHiddenStates,1*_numberOfHiddenStates)}).clone();
-            bhz = pair.value.index({torch::indexing::Slice(1*_numberOfHiddenStates,2*_numberOfHiddenStates)}).clone();
-            bhn = pair.value.index({torch::indexing::Slice(2*_numberOfHiddenStates,3*_numberOfHiddenStates)}).clone();
-          } else if (pair.name == "linear_layer.bias") {
-            by = pair.value.clone();
-          } else if (pair.name == "linear_layer.weight") {
-            why = pair.value.clone().transpose_(0,1);
-          }
-          LOG(INFO) << "loaded: " << pair.name;
-        }
+        // tensors are handles to the shared weights
+        auto &parameters = _sharedModelPtr->parameters;
+        wxr = parameters.at("wxr");
+        wxz = parameters.at("wxz");
+        wxn = parameters.at("wxn");
+        whr = parameters.at("whr");
+        whz = parameters.at("whz");
+        whn = parameters.at("whn");
+        bxr = parameters.at("bxr");
+        bxz = parameters.at("bxz");
+        bxn = parameters.at("bxn");
+        bhr = parameters.at("bhr");
+        bhz = parameters.at("bhz");
+        bhn = parameters.at("bhn");
+        by = parameters.at("by");
+        why = parameters.at("why");
       }
       LOG(INFO) << "GRU influence predictor has been constructed.";
     }
-    void sample(std::vector<int> &inputs, std::map<std::string, int> &dict) {
+    static void prepareParameters(RecurrentInfluenceModel &model, int numberOfHiddenStates) {
+      auto &parameters = model.parameters;
+      for (const auto &pair: model.module.named_parameters()) {
+        if (pair.name == "gru.weight_ih_l0") {
+          parameters["wxr"] = pair.value.index({torch::indexing::Slice(0,1*numberOfHiddenStates)}).clone().transpose_(0,1);
+          parameters["wxz"] = pair.value.index({torch::indexing::Slice(1*numberOfHiddenStates,2*numberOfHiddenStates)}).clone().transpose_(0,1);
+          parameters["wxn"] = pair.value.index({torch::indexing::Slice(2*numberOfHiddenStates,3*numberOfHiddenStates)}).clone().transpose_(0,1);
+        } else if (pair.name == "gru.weight_hh_l0") {
+          parameters["whr"] = pair.value.index({torch::indexing::Slice(0,1*numberOfHiddenStates)}).clone().transpose_(0,1);
+          parameters["whz"] = pair.value.index({torch::indexing::Slice(1*numberOfHiddenStates,2*numberOfHiddenStates)}).clone().transpose_(0,1);
+          parameters["whn"] = pair.value.index({torch::indexing::Slice(2*numberOfHiddenStates,3*numberOfHiddenStates)}).clone().transpose_(0,1);
+        } else if (pair.name == "gru.bias_ih_l0") {
+          parameters["bxr"] = pair.value.index({torch::indexing::Slice(0,1*numberOfHiddenStates)}).clone();
+          parameters["bxz"] = pair.value.index({torch::indexing::Slice(1*numberOfHiddenStates,2*numberOfHiddenStates)}).clone();
+          parameters["bxn"] = pair.value.index({torch::indexing::Slice(2*numberOfHiddenStates,3*numberOfHiddenStates)}).clone();
+        } else if (pair.name == "gru.bias_hh_l0") {
+          parameters["bhr"] = pair.value.index({torch::indexing::Slice(0*numberOfHiddenStates,1*numberOfHiddenStates)}).clone();
+          parameters["bhz"] = pair.value.index({torch::indexing::Slice(1*numberOfHiddenStates,2*numberOfHiddenStates)}).clone();
+          parameters["bhn"] = pair.value.index({torch::indexing::Slice(2*numberOfHiddenStates,3*numberOfHiddenStates)}).clone();
+        } else if (pair.name == "linear_layer.bias") {
+          parameters["by"] = pair.value.clone();
+        } else if (pair.name == "linear_layer.weight") {
+          parameters["why"] = pair.value.clone().transpose_(0,1);
+        }
+        LOG(INFO) << "loaded: " << pair.name;
+      }
+    }
+    void sample(std::vector<int> &inputs, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {
       if ((int)inputs.size() == 0) {
         // sample from the initial belief
         for (int i=0; i <= (int)_influenceSourceVariables.size()-1; i++) {
-          dict[_influenceSourceVariables[i]] = _netPtr->getVariable(_influenceSourceVariables[i])->sampleInitialValue();
+          dict[_influenceSourceVariables[i]] = _netPtr->getVariable(_influenceSourceVariables[i])->sampleInitialValue(randomNumberGenerator);
         }
       } else {
         auto tensorInputs = torch::from_blob(inputs.data(), {1, (long int) inputs.size()}, _intOptions); 
@@ -131,13 +175,13 @@ class GRUInfluencePredictor: public RecurrentInfluencePredictor {
         }
       }   
     }
-    void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict) {
+    void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {
       VLOG(4) << "Influence Predictor Inputs: " << PrintUtils::vectorToString(inputs);
       VLOG(4) << "Influce Predictor Hidden State: " << PrintUtils::vectorToString(hiddenState);
       if (initial == true) {
         // sample from the initial belief
         for (int i=0; i <= (int)_influenceSourceVariables.size()-1; i++) {
-          dict[_influenceSourceVariables[i]] = _netPtr->getVariable(_influenceSourceVariables[i])->sampleInitialValue();
+          dict[_influenceSourceVariables[i]] = _netPtr->getVariable(_influenceSourceVariables[i])->sampleInitialValue(randomNumberGenerator);
         }
       } else {
         auto begin = std::clock();
@@ -155,7 +199,7 @@ class GRUInfluencePredictor: public RecurrentInfluencePredictor {
             auto& val = _map.at(key);
             auto probs = torch::div(expy.index({torch::indexing::Slice(count, count+val)}),torch::sum(expy.index({torch::indexing::Slice(count, count+val)}))).view(-1);
             std::discrete_distribution<int> dist (probs.data<float>(), probs.data<float>()+probs.numel());
-            dict[key] = dist(_netPtr->getRandomNumberGenerator());
+            dict[key] = dist(randomNumberGenerator);
             count+=val;
           }
           for (int i=0; i<=(int)hiddenState.size()-1; i++){
@@ -202,35 +246,46 @@ class GRUInfluencePredictor: public RecurrentInfluencePredictor {
 
 class RNNInfluencePredictor: public RecurrentInfluencePredictor {
   public:
-    RNNInfluencePredictor(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables, std::string modelPath, int numberOfHiddenStates): RecurrentInfluencePredictor(netPtr, localStatesAndActions, influenceSourceVariables, modelPath, numberOfHiddenStates) {
-      for (const auto &pair: _model.named_parameters()) {
+    RNNInfluencePredictor(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables, std::string modelPath, int numberOfHiddenStates): RecurrentInfluencePredictor(netPtr, localStatesAndActions, influenceSourceVariables, modelPath, numberOfHiddenStates, "RNN", prepareParameters) {
+      // tensors are handles to the shared weights
+      auto &parameters = _sharedModelPtr->parameters;
+      wxh = parameters.at("wxh");
+      whh = parameters.at("whh");
+      bxh = parameters.at("bxh");
+      bhh = parameters.at("bhh");
+      by = parameters.at("by");
+      why = parameters.at("why");
+      LOG(INFO) << "RNN influence predictor has been constructed.";
+    }
+    static void prepareParameters(RecurrentInfluenceModel &model, int numberOfHiddenStates) {
+      auto &parameters = model.parameters;
+      for (const auto &pair: model.module.named_parameters()) {
         if (pair.name == "gru.weight_ih_l0") {
-          wxh = pair.value.clone().transpose_(0,1);
+          parameters["wxh"] = pair.value.clone().transpose_(0,1);
         } else if (pair.name == "gru.weight_hh_l0") {
-          whh = pair.value.clone().transpose_(0,1);
+          parameters["whh"] = pair.value.clone().transpose_(0,1);
         } else if (pair.name == "gru.bias_ih_l0") {
-          bxh = pair.value.clone();
+          parameters["bxh"] = pair.value.clone();
         } else if (pair.name == "gru.bias_hh_l0") {
-          bhh = pair.value.clone();
+          parameters["bhh"] = pair.value.clone();
         } else if (pair.name == "linear_layer.bias") {
-          by = pair.value.clone();
+          parameters["by"] = pair.value.clone();
         } else if (pair.name == "linear_layer.weight") {
-          why = pair.value.clone().transpose_(0,1);
+          parameters["why"] = pair.value.clone().transpose_(0,1);
         }
         LOG(INFO) << "loaded: " << pair.name;
       }
-      LOG(INFO) << "RNN influence predictor has been constructed.";
     }
-    void sample(std::vector<int> &inputs, std::map<std::string, int> &dict) {
+    void sample(std::vector<int> &inputs, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {
       LOG(FATAL) << "not supported yet."; 
     }
-    void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict) {
+    void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {
       VLOG(4) << "Influence Predictor Inputs: " << PrintUtils::vectorToString(inputs);
       VLOG(4) << "Influce Predictor Hidden State: " << PrintUtils::vectorToString(hiddenState);
       if (initial == true) {
         // sample from the initial belief
         for (int i=0; i <= (int)_influenceSourceVariables.size()-1; i++) {
-          dict[_influenceSourceVariables[i]] = _netPtr->getVariable(_influenceSourceVariables[i])->sampleInitialValue();
+          dict[_influenceSourceVariables[i]] = _netPtr->getVariable(_influenceSourceVariables[i])->sampleInitialValue(randomNumberGenerator);
         }
       } else {
         auto begin = std::clock();
@@ -244,7 +299,7 @@ class RNNInfluencePredictor: public RecurrentInfluencePredictor {
           auto& val = _map.at(key);
           auto probs = torch::div(expy.index({torch::indexing::Slice(count, count+val)}),torch::sum(expy.index({torch::indexing::Slice(count, count+val)}))).view(-1);
           std::discrete_distribution<int> dist (probs.data<float>(), probs.data<float>()+probs.numel());
-          dict[key] = dist(_netPtr->getRandomNumberGenerator());
+          dict[key] = dist(randomNumberGenerator);
           count+=val;
         }
         for (int i=0; i<=(int)hiddenState.size()-1; i++){
@@ -265,4 +320,339 @@ class RNNInfluencePredictor: public RecurrentInfluencePredictor {
     torch::Tensor by;
 };
 
+// a read-only memory mapping of a compiled influence table
+struct MappedInfluenceTable {
+  void *mappedPtr = nullptr;
+  size_t mappedSize = 0;
+  ~MappedInfluenceTable() {
+    if (mappedPtr != nullptr) {
+      munmap(mappedPtr, mappedSize);
+    }
+  }
+};
+
+// count based influence predictor for local models with a short d-separating history
+// the empirical distributions of the influence sources given the last k (local states, action) pairs
+// are compiled from the data of DataGenerationExperiment into a dense table with alias tables for sampling
+// table file layout: header | input radices | source sizes | per key, per source: float prob[n], int32 alias[n]
+class TabularInfluencePredictor: public InfluencePredictor {
+  public:
+    struct TableHeader {
+      char magic[8];
+      int32_t historyLength;
+      int32_t numberOfInputs;
+      int32_t numberOfSources;
+      int32_t strideOfKey; // number of (prob, alias) entries per key
+      int64_t numberOfKeys;
+    };
+
+    TabularInfluencePredictor(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables, std::string modelPath, std::string dataPath, int historyLength, float smoothing=1.0): InfluencePredictor(netPtr, localStatesAndActions, influenceSourceVariables) {
+      _historyLength = historyLength;
+      computeTableShape(netPtr, localStatesAndActions, influenceSourceVariables, _historyLength, _inputRadices, _sourceSizes, _slotRadix, _numberOfKeys, _strideOfKey);
+      if (std::filesystem::exists(modelPath) == false) {
+        static std::mutex compilationMutex;
+        std::lock_guard<std::mutex> lock(compilationMutex);
+        if (std::filesystem::exists(modelPath) == false) {
+          LOG(INFO) << "Influence table " << modelPath << " does not exist, compiling it from " << dataPath << ".";
+          compile(netPtr, localStatesAndActions, influenceSourceVariables, dataPath, modelPath, _historyLength, smoothing);
+        }
+      }
+      // map the table, or share the mapping if another predictor has already mapped it
+      _sharedTablePtr = SharedResourceRegistry<MappedInfluenceTable>::get("Tabular:" + FileUtils::versionedPath(modelPath), [&]() {
+        return mapTable(modelPath);
+      });
+      validateTable(modelPath);
+      LOG(INFO) << "Tabular influence predictor with history length " << std::to_string(_historyLength) << " and " << std::to_string(_numberOfKeys) << " keys has been constructed.";
+    }
+
+    // inputs hold the full history of (local states, action) of the sequential simulator
+    void sample(std::vector<int> &inputs, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {
+      if ((int)inputs.size() == 0) {
+        sampleInitial(dict, randomNumberGenerator);
+        return;
+      }
+      int numberOfSteps = (int)inputs.size() / _sizeOfInputs;
+      int64_t key = 0;
+      for (int i=numberOfSteps-_historyLength; i<=numberOfSteps-1; i++) {
+        key = key * _slotRadix + (i < 0 ? paddingCode() : encodeStep(inputs.data() + i * _sizeOfInputs));
+      }
+      sampleFromKey(key, dict, randomNumberGenerator);
+    }
+
+    // the "hidden state" of the tabular predictor is the window of the last k step codes
+    void oneStepSample(std::vector<float> &hiddenState, std::vector<int> &inputs, bool &initial, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {
+      if (initial == true) {
+        sampleInitial(dict, randomNumberGenerator);
+      } else {
+        for (int i=0; i<=_historyLength-2; i++) {
+          hiddenState[i] = hiddenState[i+1];
+        }
+        hiddenState[_historyLength-1] = (float)encodeStep(inputs.data());
+        int64_t key = 0;
+        for (int i=0; i<=_historyLength-1; i++) {
+          key = key * _slotRadix + (int64_t)hiddenState[i];
+        }
+        sampleFromKey(key, dict, randomNumberGenerator);
+      }
+      initial = false;
+    }
+
+    std::vector<float> getInitialState() {
+      return std::vector<float>(_historyLength, (float)paddingCode());
+    }
+
+    // compile inputs.pt and outputs.pt in dataPath into a table file
+    static void compile(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables, const std::string &dataPath, const std::string &tablePath, int historyLength, float smoothing) {
+      torch::Tensor inputs;
+      torch::Tensor outputs;
+      torch::load(inputs, dataPath + "/inputs.pt");
+      torch::load(outputs, dataPath + "/outputs.pt");
+      compile(netPtr, localStatesAndActions, influenceSourceVariables, inputs, outputs, tablePath, historyLength, smoothing);
+    }
+
+    // inputs: [episodes, steps, local states and action], outputs: [episodes, steps, influence sources]
+    static void compile(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables, torch::Tensor inputs, torch::Tensor outputs, const std::string &tablePath, int historyLength, float smoothing) {
+      std::vector<int> inputRadices;
+      std::vector<int> sourceSizes;
+      int64_t slotRadix;
+      int64_t numberOfKeys;
+      int strideOfKey;
+      computeTableShape(netPtr, localStatesAndActions, influenceSourceVariables, historyLength, inputRadices, sourceSizes, slotRadix, numberOfKeys, strideOfKey);
+
+      inputs = inputs.toType(torch::kInt32).contiguous();
+      outputs = outputs.toType(torch::kInt32).contiguous();
+      int numberOfEpisodes = inputs.size(0);
+      int numberOfSteps = inputs.size(1);
+      int sizeOfInputs = inputs.size(2);
+      int sizeOfOutputs = outputs.size(2);
+      if (sizeOfInputs != (int)inputRadices.size() || sizeOfOutputs != (int)sourceSizes.size()) {
+        std::string message = "Influence data in the shape of (" + std::to_string(sizeOfInputs) + ", " + std::to_string(sizeOfOutputs) + ") does not match the local model.";
+        throw std::invalid_argument(message);
+      }
+      int *inputsData = inputs.data_ptr<int>();
+      int *outputsData = outputs.data_ptr<int>();
+
+      // count the occurrences of influence source values per history window
+      std::vector<double> counts(numberOfKeys * strideOfKey, 0.0);
+      int64_t paddingCode = slotRadix - 1;
+      std::vector<int64_t> window(historyLength);
+      for (int i=0; i<=numberOfEpisodes-1; i++) {
+        std::fill(window.begin(), window.end(), paddingCode);
+        for (int t=0; t<=numberOfSteps-1; t++) {
+          for (int s=0; s<=historyLength-2; s++) {
+            window[s] = window[s+1];
+          }
+          window[historyLength-1] = encodeStep(inputsData + ((int64_t)i * numberOfSteps + t) * sizeOfInputs, inputRadices);
+          int64_t key = 0;
+          for (auto &code: window) {
+            key = key * slotRadix + code;
+          }
+          int offset = 0;
+          for (int j=0; j<=sizeOfOutputs-1; j++) {
+            int value = outputsData[((int64_t)i * numberOfSteps + t) * sizeOfOutputs + j];
+            counts[key * strideOfKey + offset + value] += 1.0;
+            offset += sourceSizes[j];
+          }
+        }
+      }
+
+      // smooth the counts and build one alias table per key and influence source
+      TableHeader header;
+      std::memcpy(header.magic, "IAOPTAB1", 8);
+      header.historyLength = historyLength;
+      header.numberOfInputs = inputRadices.size();
+      header.numberOfSources = sourceSizes.size();
+      header.strideOfKey = strideOfKey;
+      header.numberOfKeys = numberOfKeys;
+      std::string temporaryPath = tablePath + ".tmp";
+      std::filesystem::path parentPath = std::filesystem::path(tablePath).parent_path();
+      if (parentPath.empty() == false) {
+        std::filesystem::create_directories(parentPath);
+      }
+      std::ofstream ofs(temporaryPath, std::ios::binary);
+      ofs.write((const char *)&header, sizeof(TableHeader));
+      ofs.write((const char *)inputRadices.data(), sizeof(int32_t) * inputRadices.size());
+      ofs.write((const char *)sourceSizes.data(), sizeof(int32_t) * sourceSizes.size());
+      std::vector<float> probabilities;
+      std::vector<int32_t> aliases;
+      for (int64_t key=0; key<=numberOfKeys-1; key++) {
+        int offset = 0;
+        for (auto &size: sourceSizes) {
+          double total = 0.0;
+          std::vector<double> distribution(size);
+          for (int v=0; v<=size-1; v++) {
+            distribution[v] = counts[key * strideOfKey + offset + v] + smoothing;
+            total += distribution[v];
+          }
+          for (auto &p: distribution) {
+            p = (total > 0.0) ? p / total : 1.0 / size;
+          }
+          buildAliasTable(distribution, probabilities, aliases);
+          ofs.write((const char *)probabilities.data(), sizeof(float) * size);
+          ofs.write((const char *)aliases.data(), sizeof(int32_t) * size);
+          offset += size;
+        }
+      }
+      ofs.close();
+      std::filesystem::rename(temporaryPath, tablePath);
+      LOG(INFO) << "Influence table with " << std::to_string(numberOfKeys) << " keys has been written to " << tablePath << ".";
+    }
+
+  private:
+    int _historyLength;
+    std::vector<int> _inputRadices;
+    std::vector<int> _sourceSizes;
+    int64_t _slotRadix;
+    int64_t _numberOfKeys;
+    int _strideOfKey;
+    std::shared_ptr<const MappedInfluenceTable> _sharedTablePtr;
+    const float *_tablePtr; // interleaved float probabilities and int32 aliases
+
+    // the largest table we are willing to build, in number of (prob, alias) entries
+    static constexpr int64_t _maximumNumberOfEntries = (int64_t)1 << 26;
+    static constexpr int64_t _maximumSlotRadix = (int64_t)1 << 24;
+
+    static void computeTableShape(TwoStageDynamicBayesianNetwork *netPtr, std::vector<std::string> &localStatesAndActions, std::vector<std::string> &influenceSourceVariables, int historyLength, std::vector<int> &inputRadices, std::vector<int> &sourceSizes, int64_t &slotRadix, int64_t &numberOfKeys, int &strideOfKey) {
+      if (historyLength < 1) {
+        throw std::invalid_argument("History length of the tabular influence predictor should be at least 1.");
+      }
+      inputRadices.clear();
+      sourceSizes.clear();
+      int64_t stepRadix = 1;
+      for (auto &key: localStatesAndActions) {
+        inputRadices.push_back(netPtr->getVariable(key)->getNumberOfValues());
+        stepRadix *= inputRadices.back();
+        // the recurrent simulators keep the codes of the window in their float hidden state, which holds integers exactly up to 2^24
+        if (stepRadix + 1 > _maximumSlotRadix) {
+          throw std::invalid_argument("The local states and actions of this local model have too many values for a tabular influence predictor, use a recurrent influence predictor instead.");
+        }
+      }
+      strideOfKey = 0;
+      for (auto &key: influenceSourceVariables) {
+        sourceSizes.push_back(netPtr->getVariable(key)->getNumberOfValues());
+        strideOfKey += sourceSizes.back();
+      }
+      // one extra code per slot for padding the history before the first step
+      slotRadix = stepRadix + 1;
+      numberOfKeys = 1;
+      for (int i=0; i<=historyLength-1; i++) {
+        numberOfKeys *= slotRadix;
+        if (numberOfKeys * strideOfKey > _maximumNumberOfEntries) {
+          std::string message = "The influence table with history length " + std::to_string(historyLength) + " is too large for this local model, use a recurrent influence predictor instead.";
+          throw std::invalid_argument(message);
+        }
+      }
+    }
+
+    static int64_t encodeStep(const int *inputs, const std::vector<int> &inputRadices) {
+      int64_t code = 0;
+      for (int i=0; i<=(int)inputRadices.size()-1; i++) {
+        code = code * inputRadices[i] + inputs[i];
+      }
+      return code;
+    }
+
+    int64_t encodeStep(const int *inputs) {
+      return encodeStep(inputs, _inputRadices);
+    }
+
+    int64_t paddingCode() {
+      return _slotRadix - 1;
+    }
+
+    // Vose's alias method
+    static void buildAliasTable(const std::vector<double> &distribution, std::vector<float> &probabilities, std::vector<int32_t> &aliases) {
+      int n = distribution.size();
+      probabilities.assign(n, 1.0);
+      aliases.resize(n);
+      std::vector<double> scaled(n);
+      std::vector<int> small;
+      std::vector<int> large;
+      for (int i=0; i<=n-1; i++) {
+        aliases[i] = i;
+        scaled[i] = distribution[i] * n;
+        if (scaled[i] < 1.0) {
+          small.push_back(i);
+        } else {
+          large.push_back(i);
+        }
+      }
+      while (small.empty() == false && large.empty() == false) {
+        int s = small.back();
+        small.pop_back();
+        int l = large.back();
+        probabilities[s] = scaled[s];
+        aliases[s] = l;
+        scaled[l] = scaled[l] + scaled[s] - 1.0;
+        if (scaled[l] < 1.0) {
+          large.pop_back();
+          small.push_back(l);
+        }
+      }
+    }
+
+    static MappedInfluenceTable *mapTable(const std::string &tablePath) {
+      int fd = open(tablePath.c_str(), O_RDONLY);
+      if (fd < 0) {
+        throw std::runtime_error("Failed to open influence table " + tablePath + ".");
+      }
+      struct stat fileStat;
+      fstat(fd, &fileStat);
+      MappedInfluenceTable *tablePtr = new MappedInfluenceTable();
+      tablePtr->mappedSize = fileStat.st_size;
+      tablePtr->mappedPtr = mmap(nullptr, tablePtr->mappedSize, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+      if (tablePtr->mappedPtr == MAP_FAILED) {
+        tablePtr->mappedPtr = nullptr;
+        delete tablePtr;
+        throw std::runtime_error("Failed to map influence table " + tablePath + ".");
+      }
+      return tablePtr;
+    }
+
+    void validateTable(const std::string &tablePath) {
+      const char *bytes = (const char *)_sharedTablePtr->mappedPtr;
+      size_t mappedSize = _sharedTablePtr->mappedSize;
+      if (mappedSize < sizeof(TableHeader)) {
+        throw std::invalid_argument("Influence table " + tablePath + " is truncated.");
+      }
+      TableHeader header;
+      std::memcpy(&header, bytes, sizeof(TableHeader));
+      size_t sizeOfShapes = sizeof(int32_t) * (header.numberOfInputs + header.numberOfSources);
+      bool matched = std::memcmp(header.magic, "IAOPTAB1", 8) == 0
+        && header.historyLength == _historyLength
+        && header.numberOfInputs == (int)_inputRadices.size()
+        && header.numberOfSources == (int)_sourceSizes.size()
+        && header.strideOfKey == _strideOfKey
+        && header.numberOfKeys == _numberOfKeys
+        && mappedSize == sizeof(TableHeader) + sizeOfShapes + sizeof(float) * 2 * _numberOfKeys * _strideOfKey
+        && std::memcmp(bytes + sizeof(TableHeader), _inputRadices.data(), sizeof(int32_t) * _inputRadices.size()) == 0
+        && std::memcmp(bytes + sizeof(TableHeader) + sizeof(int32_t) * _inputRadices.size(), _sourceSizes.data(), sizeof(int32_t) * _sourceSizes.size()) == 0;
+      if (matched == false) {
+        throw std::invalid_argument("Influence table " + tablePath + " does not match the local model.");
+      }
+      _tablePtr = (const float *)(bytes + sizeof(TableHeader) + sizeOfShapes);
+    }
+
+    void sampleInitial(std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {
+      for (auto &factorName: _influenceSourceVariables) {
+        dict[factorName] = _netPtr->getVariable(factorName)->sampleInitialValue(randomNumberGenerator);
+      }
+    }
+
+    // a single alias table draw per influence source
+    void sampleFromKey(int64_t key, std::map<std::string, int> &dict, std::default_random_engine &randomNumberGenerator) {
+      const float *entryPtr = _tablePtr + 2 * key * _strideOfKey;
+      std::uniform_real_distribution<float> uniform(0.0, 1.0);
+      for (int j=0; j<=(int)_influenceSourceVariables.size()-1; j++) {
+        int size = _sourceSizes[j];
+        const float *probabilities = entryPtr;
+        const int32_t *aliases = (const int32_t *)(entryPtr + size);
+        int index = std::uniform_int_distribution<int>(0, size-1)(randomNumberGenerator);
+        dict[_influenceSourceVariables[j]] = (uniform(randomNumberGenerator) < probabilities[index]) ? index : aliases[index];
+        entryPtr += 2 * size;
+      }
+    }
+};
+
 #endif
\ No newline at end of file
@@ -89,6 +89,19 @@ def generate_data(config_path, data_folder_path):
   print(command)
   print(os.system(command))
 
+# sample data for training influence predictor in this process, with the python module maps (cmake -DBUILD_PYTHON_BINDINGS=ON)
+def sample_data(config_path, seed=None):
+  import maps
+  config = yaml.load(open(config_path, "r"), Loader=yaml.FullLoader)
+  agent_id = str(config["General"]["IDOfAgentToControl"])
+  horizon = config["General"]["horizon"]
+  number_of_episodes = config["AgentComponent"][agent_id]["Simulator"]["InfluencePredictor"]["numberOfSampledEpisodesForTraining"]
+  simulator = maps.GlobalSimulator(maps.Domain(config_path), agent_id)
+  inputs = np.zeros((number_of_episodes, horizon-1, len(simulator.inputs)), dtype=np.int32)
+  outputs = np.zeros((number_of_episodes, horizon-1, len(simulator.outputs)), dtype=np.int32)
+  simulator.influence_data(inputs, outputs, seed=seed)
+  return torch.from_numpy(inputs), torch.from_numpy(outputs)
+
 def train_influence_predictor(
     config_path,
     generate_new_data=False,
@@ -98,7 +111,8 @@ def train_influence_predictor(
     num_epochs = 1000,
     data_path=None,
     core="GRU",
-    save_model=True
+    save_model=True,
+    in_process=False
 ):
     config = yaml.load(open(config_path, "r"), Loader=yaml.FullLoader)
     
@@ -106,14 +120,18 @@ def train_influence_predictor(
     if data_path is None:
       data_path = the_path
     
-    if generate_new_data is True or os.path.exists(data_path) is False:
+    if in_process is False and (generate_new_data is True or os.path.exists(data_path) is False):
         generate_data(config_path, data_path)
     
     hidden_state_size = config["AgentComponent"][config["General"]["IDOfAgentToControl"]]["Simulator"]["InfluencePredictor"]["numberOfHiddenStates"]
     core = config["AgentComponent"][config["General"]["IDOfAgentToControl"]]["Simulator"]["InfluencePredictor"]["Type"]
-    # read inputs and outputs from files
-    inputs = torch.jit.load(os.path.join(data_path,"inputs.pt"))._parameters['0']
-    outputs = torch.jit.load(os.path.join(data_path,"outputs.pt"))._parameters['0']
+    if in_process is True:
+        # sample fresh data instead of reading it from files
+        inputs, outputs = sample_data(config_path)
+    else:
+        # read inputs and outputs from files
+        inputs = torch.jit.load(os.path.join(data_path,"inputs.pt"))._parameters['0']
+        outputs = torch.jit.load(os.path.join(data_path,"outputs.pt"))._parameters['0']
     print("inputs:", inputs.shape)
     print("outputs:", outputs.shape)
     print("data loaded.")
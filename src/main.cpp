@@ -4,19 +4,39 @@
 #include "glog/logging.h"
 #include <stdlib.h>
 #include <ctime>
+#include <chrono>
 #include <memory>
 #include "runners/Experiment.hpp"
 #include "runners/DataGenerationExperiment.hpp"
+#include "runners/ModelCheckExperiment.hpp"
+#include "runners/ScalingExperiment.hpp"
+#include "runners/SweepExperiment.hpp"
+#include "runners/MergeExperiment.hpp"
+#include "runners/ServeExperiment.hpp"
 namespace fs = std::filesystem;
 
-bool runExperiment(std::string typeOfExperiment, std::string pathToConfigurationFile, std::string pathToResultsFolder){
+bool runExperiment(std::string typeOfExperiment, std::string pathToConfigurationFile, std::string pathToResultsFolder, Shard shard){
   std::unique_ptr<Experiment> experiment;
+  if (shard.count > 1 && typeOfExperiment != "Planning" && typeOfExperiment != "Sweep") {
+    LOG(FATAL) << "Error: only Planning and Sweep experiments can be sharded.";
+    return false;
+  }
   if (typeOfExperiment == "Testing"){
     experiment = std::unique_ptr<Experiment>(new TestingExperiment(pathToConfigurationFile, pathToResultsFolder));
   } else if (typeOfExperiment == "Planning"){
-    experiment = std::unique_ptr<Experiment>(new PlanningExperiment(pathToConfigurationFile, pathToResultsFolder));
+    experiment = std::unique_ptr<Experiment>(new PlanningExperiment(pathToConfigurationFile, pathToResultsFolder, shard));
   } else if (typeOfExperiment == "DataGeneration"){
     experiment = std::unique_ptr<Experiment>(new DataGenerationExperiment(pathToConfigurationFile, pathToResultsFolder));
+  } else if (typeOfExperiment == "ModelCheck"){
+    experiment = std::unique_ptr<Experiment>(new ModelCheckExperiment(pathToConfigurationFile, pathToResultsFolder));
+  } else if (typeOfExperiment == "Scaling"){
+    experiment = std::unique_ptr<Experiment>(new ScalingExperiment(pathToConfigurationFile, pathToResultsFolder));
+  } else if (typeOfExperiment == "Sweep"){
+    experiment = std::unique_ptr<Experiment>(new SweepExperiment(pathToConfigurationFile, pathToResultsFolder, shard));
+  } else if (typeOfExperiment == "Merge"){
+    experiment = std::unique_ptr<Experiment>(new MergeExperiment(pathToConfigurationFile, pathToResultsFolder));
+  } else if (typeOfExperiment == "Serve"){
+    experiment = std::unique_ptr<Experiment>(new ServeExperiment(pathToConfigurationFile, pathToResultsFolder));
   } else {
     LOG(FATAL) << "Error: Experiment type not supported.";
     return false;
@@ -26,11 +46,13 @@ bool runExperiment(std::string typeOfExperiment, std::string pathToConfiguration
 
 int main(int argc, char** argv){
 
-  if (argc != 4) {
+  bool withShard = argc == 6 && std::string(argv[4]) == "--shard";
+  if (argc != 4 && withShard == false) {
     std::cerr << "Three arguments are required for lanuching an experiment." << std::endl;
     std::cerr << "1. typeOfExperiment" << std::endl;
     std::cerr << "2. pathToConfigurationFile" << std::endl;
     std::cerr << "3. pathToResultsFolder" << std::endl;
+    std::cerr << "optionally followed by --shard index/count to run a subset of the episodes" << std::endl;
     return 1;
   }
 
@@ -43,6 +65,17 @@ int main(int argc, char** argv){
   // the path to the folder where we store experiment results
   std::string pathToResultsFolder = argv[3];
 
+  // the subset of the episodes to run, all of them by default
+  Shard shard;
+  if (withShard == true) {
+    try {
+      shard = Shard::parse(argv[5]);
+    } catch (const std::invalid_argument &e) {
+      std::cerr << e.what() << std::endl;
+      return 1;
+    }
+  }
+
   // create the folder to store results if not already existing
   fs::path pathToLogsFolder = pathToResultsFolder + "/logs/";
   fs::create_directories(pathToLogsFolder);
@@ -60,15 +93,25 @@ int main(int argc, char** argv){
   LOG(INFO) << "Type of the experiment: " << typeOfExperiment;
   LOG(INFO) << "Path to configuration file: " << pathToConfigurationFile;
   LOG(INFO) << "Path to results: " << pathToResultsFolder;
+  if (shard.count > 1) {
+    LOG(INFO) << "Shard: " << shard.index << "/" << shard.count;
+  }
   LOG(INFO) << "Path to logs: " << pathToLogsFolder;
   LOG(INFO) << "--------------------------------------------------";
 
-  clock_t begin = std::clock();
+  // wall clock time, the processor time of parallel episodes adds up over their threads
+  auto begin = std::chrono::steady_clock::now();
 
-  auto status = runExperiment(typeOfExperiment, pathToConfigurationFile, pathToResultsFolder);
+  bool status;
+  try {
+    status = runExperiment(typeOfExperiment, pathToConfigurationFile, pathToResultsFolder, shard);
+  } catch (const std::exception &e) {
+    // errors in the configuration are thrown, so that a server or a library can survive them
+    LOG(ERROR) << e.what();
+    status = false;
+  }
 
-  clock_t end = std::clock();
-  double elapsed_seconds = double(end-begin) / CLOCKS_PER_SEC;
+  double elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
 
   LOG(INFO) << "Elapsed time: " << elapsed_seconds << " seconds.";
 
@@ -7,6 +7,7 @@
 #include <torch/torch.h>
 #include <iostream>
 #include "Utils.hpp"
+#include "influence/InfluenceDataSampler.hpp"
 
 class DataGenerationExperiment: public Experiment {
 
@@ -33,7 +34,6 @@ class DataGenerationExperiment: public Experiment {
 
       // set up the domain
       Domain *domainPtr = makeDomain(domainName);
-      int numberOfActions = domainPtr->getAgentsSpecification()[agentID];
 
       // set up the global simulator
       Domain::SingleAgentGlobalSimulator *globalSimulatorPtr = new Domain::SingleAgentGlobalSimulator(
@@ -43,65 +43,33 @@ class DataGenerationExperiment: public Experiment {
       );
 
       // create placeholder tensors for inputs and outputs
-      std::vector<std::string> localStates;
-      std::vector<std::string> localFactors;
-      std::vector<std::string> influenceSourceStates;
-      std::vector<std::string> influenceDestinationStates;
-      std::vector<std::string> localStatesActions;
-      domainPtr->getDBNPtr()->constructLocalModel(agentID, localFactors, localStates, influenceSourceStates, influenceDestinationStates, localStatesActions);
-      
-      int sizeOfInputs = localStatesActions.size();
-      int sizeOfOutputs = influenceSourceStates.size();
+      InfluenceDataSampler sampler(agentID, domainPtr, globalSimulatorPtr);
+      int sizeOfInputs = sampler.getInputs().size();
+      int sizeOfOutputs = sampler.getOutputs().size();
       auto inputs = torch::zeros({numOfRepeats, horizon-1, sizeOfInputs}, torch::TensorOptions().dtype(torch::kInt32));
       auto outputs = torch::zeros({numOfRepeats, horizon-1, sizeOfOutputs}, torch::TensorOptions().dtype(torch::kInt32));
 
-      LOG(INFO) << "[Influence Predictor Training] inputs: " << PrintUtils::vectorToTupleString(localFactors);
+      LOG(INFO) << "[Influence Predictor Training] inputs: " << PrintUtils::vectorToTupleString(sampler.getLocalFactors());
       LOG(INFO) << "[Influence Predictor Training] size of inputs: " << inputs.sizes();
-      LOG(INFO) << "[Influence Predictor Training] outputs: " << PrintUtils::vectorToTupleString(influenceSourceStates);
+      LOG(INFO) << "[Influence Predictor Training] outputs: " << PrintUtils::vectorToTupleString(sampler.getOutputs());
       LOG(INFO) << "[Influence Predictor Training] size of outputs: " << outputs.sizes();
 
-      // data collection
-      int observation;
-      float reward;
-      bool done;
-      for (int i=0; i<=numOfRepeats-1; i++) {
-        // sample one state
-        auto state = globalSimulatorPtr->sampleInitialState();
-        // do the trajectory simulation
-        for (int step=0; step<=horizon-1; step++) {
-          int action = std::experimental::randint(0, numberOfActions-1);
-          globalSimulatorPtr->step(state, action, observation, reward, done);
-
-          if (step <= horizon-2) {
-            // extract local states and actions and influence sources
-            for (int j=0; j<=localStates.size()-1; j++){
-              inputs[i][step][j] = state.environmentState[localStates[j]];
-            }
-            inputs[i][step][localStates.size()] = action;
-            // outputs
-            for (int j=0; j<=influenceSourceStates.size()-1; j++) {
-              if (influenceSourceStates.at(j)[0] != 'a') {
-                outputs[i][step][j] = state.environmentState[influenceSourceStates[j]];
-              } else {
-                if (step != 0) {
-                  outputs[i][step-1][j] = state.environmentState[influenceSourceStates[j]];
-                }
-              }
-            }
-          } else {
-            for (int j=0; j<=influenceSourceStates.size()-1; j++) {
-              if (influenceSourceStates.at(j)[0] == 'a') {
-                outputs[i][step-1][j] = state.environmentState[influenceSourceStates[j]];
-              }
-            }
-          }
-        }
-      }
+      // data collection, written directly into the memory of the tensors
+      Domain::SimulationContext simulationContext;
+      globalSimulatorPtr->prepareContext(simulationContext);
+      sampler.sample(numOfRepeats, horizon, inputs.data_ptr<int>(), outputs.data_ptr<int>(), simulationContext);
 
       // save data
       torch::save(inputs, pathToResultsFolder+"/inputs.pt");
       torch::save(outputs, pathToResultsFolder+"/outputs.pt");
 
+      // compile the data into an influence table for the tabular influence predictor
+      YAML::Node predictorParameters = parameters["AgentComponent"][agentID]["Simulator"]["InfluencePredictor"];
+      if (predictorParameters["Type"].as<std::string>() == "Tabular") {
+        float smoothing = predictorParameters["smoothing"].IsDefined() ? predictorParameters["smoothing"].as<float>() : 1.0;
+        TabularInfluencePredictor::compile(domainPtr->getDBNPtr(), sampler.getInputs(), sampler.getOutputs(), inputs, outputs, pathToResultsFolder+"/table.bin", predictorParameters["historyLength"].as<int>(), smoothing);
+      }
+
       delete domainPtr;
       delete globalSimulatorPtr;
 
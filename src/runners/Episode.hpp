@@ -17,7 +17,7 @@ class Episode {
       _pathToReplaysFolder = _pathToResultsFolder + "/replays/";
     }
 
-    std::map<std::string, std::map<std::string, std::vector<double>>> dispatch(){
+    EpisodeMetrics dispatch(){
       LOG(INFO) << "--------------------------------------------------";
       LOG(INFO) << "Episode " << std::to_string(_episodeID) << " has been dispatched.";
 
@@ -26,7 +26,8 @@ class Episode {
       double stepTime = 0.0;
       double observeTime = 0.0;
 
-      std::map<std::string, std::map<std::string, std::vector<double>>> results;
+      EpisodeMetrics metrics(_agentComponentPtr->getAgentIDs(), _horizon);
+      std::vector<int> slotsOfRewards; // the slots of the agents in the reward map, resolved at the first step
       _agentComponentPtr->reset();
       _environmentPtr->reset();
       std::map<std::string, int> action;
@@ -45,27 +46,29 @@ class Episode {
           agentsYAMLNode["save"] = false;
         }
 
-        auto begin = std::clock();
-        _agentComponentPtr->act(action, results, agentsYAMLNode);
-        actTime += (double)(std::clock()-begin)/CLOCKS_PER_SEC;
-        begin = std::clock();
+        double begin = TimeUtils::threadProcessorTime();
+        _agentComponentPtr->act(action, metrics, agentsYAMLNode);
+        actTime += TimeUtils::threadProcessorTime() - begin;
+        begin = TimeUtils::threadProcessorTime();
         // LOG(INFO) << PrintUtils::mapToTupleString(_environmentPtr->getState());
         _environmentPtr->step(action, observation, reward, done);
-        stepTime += (double)(std::clock()-begin)/CLOCKS_PER_SEC;
-        begin = std::clock();
+        stepTime += TimeUtils::threadProcessorTime() - begin;
+        begin = TimeUtils::threadProcessorTime();
         // LOG(INFO) << "true: " << PrintUtils::mapToTupleString(_environmentPtr->getState());
         _agentComponentPtr->observe(observation);
-        observeTime += (double)(std::clock()-begin)/CLOCKS_PER_SEC;
+        observeTime += TimeUtils::threadProcessorTime() - begin;
 
+        if (slotsOfRewards.size() == 0) {
+          for (auto &[key, val]: reward) {
+            slotsOfRewards.push_back(metrics.getSlot(key));
+          }
+        }
+        int j = 0;
         for (auto &[key, val]: reward) {
           float discounted_reward = factor * val;
-          if (results["episodic_return"].count(key) == 0){
-            results["episodic_return"][key].push_back(val);
-            results["discounted_episodic_return"][key].push_back(discounted_reward);
-          } else {
-            results["episodic_return"][key][0] += val;
-            results["discounted_episodic_return"][key][0] += discounted_reward;
-          }
+          metrics.add(EPISODIC_RETURN, slotsOfRewards[j], val);
+          metrics.add(DISCOUNTED_EPISODIC_RETURN, slotsOfRewards[j], discounted_reward);
+          j += 1;
         }
 
         // LOG(INFO) << "[step" << std::to_string(i) << "] reward of agent 1: " << std::to_string(int(reward["1"]));
@@ -91,7 +94,7 @@ class Episode {
       VLOG(2) << "act time in total: " << std::to_string(actTime);
       VLOG(2) << "step time in total: " << std::to_string(stepTime);
       VLOG(2) << "observe time in total: " << std::to_string(observeTime);
-      return results;
+      return metrics;
     }
 
     virtual ~Episode(){
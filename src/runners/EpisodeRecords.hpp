@@ -0,0 +1,96 @@
+#ifndef EPISODE_RECORDS_HPP_
+#define EPISODE_RECORDS_HPP_
+
+#include <fstream>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <json.hpp>
+#include "glog/logging.h"
+
+// an append-only file of finished episodes, one JSON object per line: {"episode": 3, "seed": 7, "results": {...}}
+// every record is flushed as soon as the episode has finished, so the episodes of a crashed or preempted experiment can be read back
+// and skipped when the experiment is resumed
+class EpisodeRecords {
+  public:
+    typedef std::map<std::string, std::map<std::string, std::vector<double>>> Results;
+
+    EpisodeRecords(const std::string &path, bool resume): _path(path) {
+      if (resume == true && std::filesystem::exists(_path)) {
+        read(_path, _finishedEpisodes, _lines, _seeds);
+        // the valid records are written back, so that a record cut off by a crash is not continued by the next one
+        std::string temporaryPath = _path + ".tmp";
+        std::ofstream temporaryFile(temporaryPath, std::ios::trunc);
+        for (auto &[episodeID, line]: _lines) {
+          temporaryFile << line << "\n";
+        }
+        temporaryFile.close();
+        std::filesystem::rename(temporaryPath, _path);
+        _lines.clear();
+        LOG(INFO) << "[Episode Records] " << _finishedEpisodes.size() << " finished episodes are read from " << _path << ".";
+        _file.open(_path, std::ios::app);
+      } else {
+        _file.open(_path, std::ios::trunc);
+      }
+      if (_file.is_open() == false) {
+        throw std::runtime_error("cannot open " + _path + " for writing.");
+      }
+    }
+
+    void write(int episodeID, unsigned int seed, const Results &results) {
+      nlohmann::json record;
+      record["episode"] = episodeID;
+      record["seed"] = seed;
+      record["results"] = results;
+      _file << record.dump() << "\n";
+      _file.flush();
+    }
+
+    // the results of the episodes read back on resume, by episode ID
+    const std::map<int, Results> &getFinishedEpisodes() {
+      return _finishedEpisodes;
+    }
+
+    // the seed of the experiment the records were written by, false if there are no records
+    bool getSeed(unsigned int &seed) {
+      if (_seeds.size() == 0) {
+        return false;
+      }
+      if (_seeds.size() > 1) {
+        LOG(WARNING) << "[Episode Records] the records of " << _path << " were written with " << _seeds.size() << " different seeds.";
+      }
+      seed = *_seeds.begin();
+      return true;
+    }
+
+    // reads the complete records of a file without changing it
+    static void read(const std::string &path, std::map<int, Results> &finishedEpisodes, std::map<int, std::string> &lines, std::set<unsigned int> &seeds) {
+      std::ifstream file(path);
+      std::string line;
+      int lineNumber = 0;
+      while (std::getline(file, line)) {
+        lineNumber += 1;
+        if (line.empty()) {
+          continue;
+        }
+        try {
+          nlohmann::json record = nlohmann::json::parse(line);
+          int episodeID = record.at("episode").get<int>();
+          finishedEpisodes[episodeID] = record.at("results").get<Results>();
+          seeds.insert(record.at("seed").get<unsigned int>());
+          lines[episodeID] = line;
+        } catch (const std::exception &e) {
+          LOG(WARNING) << "[Episode Records] line " << lineNumber << " of " << path << " is not a complete record and is dropped.";
+        }
+      }
+    }
+
+  private:
+    std::string _path;
+    std::ofstream _file;
+    std::map<int, Results> _finishedEpisodes;
+    std::map<int, std::string> _lines;
+    std::set<unsigned int> _seeds;
+};
+
+#endif
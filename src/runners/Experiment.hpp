@@ -4,6 +4,9 @@
 #include <fstream>
 #include <map>
 #include <any>
+#include <atomic>
+#include <mutex>
+#include <filesystem>
 #include "yaml-cpp/yaml.h"
 #include "omp.h"
 #include "domains/Domain.hpp"
@@ -14,6 +17,45 @@
 #include "agents/AtomicAgent.hpp"
 #include "agents/PlanningAgent.hpp"
 #include "Episode.hpp"
+#include "EpisodeRecords.hpp"
+#include "ProcessPool.hpp"
+
+// a deterministic subset of the episodes of an experiment, to spread its episodes over processes or machines
+// shard index of count runs the episodes whose ID is index modulo count, and writes its results to shards/<index>of<count> in the results folder
+struct Shard {
+  int index = 0;
+  int count = 1;
+
+  // parses "i/n"
+  static Shard parse(const std::string &text) {
+    Shard shard;
+    size_t slash = text.find('/');
+    try {
+      if (slash == std::string::npos) {
+        throw std::invalid_argument(text);
+      }
+      shard.index = std::stoi(text.substr(0, slash));
+      shard.count = std::stoi(text.substr(slash+1));
+    } catch (const std::logic_error &e) {
+      throw std::invalid_argument("a shard is given as index/count, not " + text + ".");
+    }
+    if (shard.count < 1 || shard.index < 0 || shard.index >= shard.count) {
+      throw std::invalid_argument("shard " + text + " does not exist.");
+    }
+    return shard;
+  }
+
+  bool contains(int episodeID) const {
+    return episodeID % count == index;
+  }
+
+  std::string getResultsFolder(const std::string &pathToResultsFolder) const {
+    if (count == 1) {
+      return pathToResultsFolder;
+    }
+    return pathToResultsFolder + "/shards/" + std::to_string(index) + "of" + std::to_string(count);
+  }
+};
 
 class Experiment {
 
@@ -25,6 +67,12 @@ public:
         LOG(INFO) << "\n-------------Experimental Parameters:-------------\n" << parameters << "\n--------------------------------------------------\n";
     }
 
+    // an experiment of a configuration that has already been loaded, for example by a sweep
+    Experiment(const YAML::Node &parameters, std::string pathToResultsFolder){
+        this->pathToResultsFolder = pathToResultsFolder;
+        this->parameters = parameters;
+    }
+
     virtual bool run(){
         std::cerr << "Error: Experiment Not Implemented." << std::endl;
         return false;
@@ -34,6 +82,11 @@ public:
     }
 
     Domain *makeDomain(const std::string &domain) {
+      return makeDomain(domain, parameters);
+    }
+
+    // a domain with other parameters than those of the experiment, for example for a generated instance
+    static Domain *makeDomain(const std::string &domain, const YAML::Node &parameters) {
       if (domain == "GridTraffic") {
         return new GridTrafficDomain(parameters);
       } else if (domain == "GrabAChair") {
@@ -73,126 +126,356 @@ public:
 
 };
 
+// the domain of a planning experiment and the agent components and environments of its workers
+// they are kept by a server for later runs of the same configuration, every episode resets and seeds the ones it uses
+struct PlanningResources {
+  Domain *domainPtr = nullptr;
+  std::vector<AgentComponent*> agentComponentPtrs;
+  std::vector<Domain::Environment*> environmentPtrs;
+
+  ~PlanningResources() {
+    for (int w=0; w<=(int)agentComponentPtrs.size()-1; w++) {
+      delete agentComponentPtrs[w];
+      delete environmentPtrs[w];
+    }
+    delete domainPtr;
+  }
+};
+
 class PlanningExperiment: public Experiment {
 
   public:
 
-    PlanningExperiment(std::string pathToConfigurationFile, std::string pathToResultsFolder):Experiment(pathToConfigurationFile, pathToResultsFolder){};
+    PlanningExperiment(std::string pathToConfigurationFile, std::string pathToResultsFolder, Shard shard = Shard()):Experiment(pathToConfigurationFile, shard.getResultsFolder(pathToResultsFolder)), shard(shard){
+      std::filesystem::create_directories(this->pathToResultsFolder + "/replays/");
+    };
+
+    PlanningExperiment(const YAML::Node &parameters, std::string pathToResultsFolder, Shard shard = Shard()):Experiment(parameters, shard.getResultsFolder(pathToResultsFolder)), shard(shard){
+      std::filesystem::create_directories(this->pathToResultsFolder + "/replays/");
+    };
 
     ~PlanningExperiment() {
     }
 
     bool run(){
+      int numberOfWorkers = parameters["Experiment"]["numberOfWorkers"].IsDefined() ? parameters["Experiment"]["numberOfWorkers"].as<int>() : 1;
+      // the workers are threads or, for isolation from the global state of libtorch, processes forked once everything is loaded
+      std::string workerType = parameters["Experiment"]["workerType"].IsDefined() ? parameters["Experiment"]["workerType"].as<std::string>() : "Thread";
+      if (workerType == "Process") {
+        prepare(numberOfWorkers, true);
+        runEpisodesInProcesses();
+      } else if (workerType == "Thread") {
+        prepare(numberOfWorkers);
+        ProcessPool::markThreadsStarted();
+        #pragma omp parallel for schedule(dynamic, 1) num_threads(this->numberOfWorkers)
+        for (int i=0; i<=numOfRepeats-1; i++){
+          runEpisode(i);
+        }
+      } else {
+        throw std::invalid_argument("worker type " + workerType + " is not supported.");
+      }
+      finish();
+      return true;
+    }
 
-      bool fullLogging = parameters["Experiment"]["fullLogging"].as<bool>();
-      std::string IDOfAgentToControl = parameters["General"]["IDOfAgentToControl"].as<std::string>();
+    // reads the configuration and builds the domain and, for each of the workers, an agent component and an environment
+    // numberOfWorkers is the number of episodes that may run at once. worker processes share a single agent component and environment,
+    // of which each process has its own copy
+    void prepare(int numberOfWorkers, bool workerProcesses = false) {
+      fullLogging = parameters["Experiment"]["fullLogging"].as<bool>();
+      IDOfAgentToControl = parameters["General"]["IDOfAgentToControl"].as<std::string>();
+      std::string domainName = parameters["General"]["domain"].as<std::string>();
+      numOfRepeats = parameters["Experiment"]["repeat"].as<int>();
+      horizon = parameters["General"]["horizon"].as<int>();
+      discountFactor = parameters["General"]["discountFactor"].as<float>();
+      saveReplay = parameters["Experiment"]["saveReplay"].as<bool>();
+
+      // episodes are run by a pool of workers, and every episode is seeded from the seed of the experiment and its ID,
+      // so that the results do not depend on the number of workers
+      this->numberOfWorkers = std::max(1, std::min(numberOfWorkers, numOfRepeats));
+      seed = parameters["Experiment"]["seed"].IsDefined() ? parameters["Experiment"]["seed"].as<unsigned int>() : std::random_device()();
+
+      // every finished episode is appended to results.jsonl, a resumed experiment skips the episodes found there
+      // and continues with their seed unless a seed is given
+      bool resume = parameters["Experiment"]["resume"].IsDefined() ? parameters["Experiment"]["resume"].as<bool>() : false;
+      records = std::unique_ptr<EpisodeRecords>(new EpisodeRecords(pathToResultsFolder+"/results.jsonl", resume));
+      if (parameters["Experiment"]["seed"].IsDefined() == false && records->getSeed(seed) == false && shard.count > 1) {
+        throw std::invalid_argument("the shards of an experiment need the seed under Experiment.");
+      }
+      if (shard.count > 1) {
+        LOG(INFO) << "Shard " << shard.index << " of " << shard.count << " runs the episodes with IDs " << shard.index << " modulo " << shard.count << ".";
+      }
+      LOG(INFO) << numOfRepeats << " episodes are run by " << this->numberOfWorkers << (workerProcesses ? " worker processes" : " workers") << " with seed " << seed << ".";
 
-      // create the csv file for experimental results
-      YAML::Node resultsYAML;
+      // every worker owns an agent component and an environment, the domain with the DBN and the influence predictors is shared
+      // resources given by setResources are reused, and extended if there are more workers than before
+      if (resources == nullptr) {
+        resources = std::make_shared<PlanningResources>();
+      }
+      if (resources->domainPtr == nullptr) {
+        resources->domainPtr = makeDomain(domainName);
+      }
+      domainPtr = resources->domainPtr;
+      for (int w=0; w<=(workerProcesses ? 0 : this->numberOfWorkers-1); w++) {
+        if (w > (int)resources->agentComponentPtrs.size()-1) {
+          resources->agentComponentPtrs.push_back(makeAgentComponent(domainPtr));
+          resources->environmentPtrs.push_back(domainPtr->makeEnvironment());
+        }
+        agentComponentPtrs.push_back(resources->agentComponentPtrs[w]);
+        environmentPtrs.push_back(resources->environmentPtrs[w]);
+        freeWorkers.insert(freeWorkers.begin(), w);
+      }
 
-      std::string domainName = parameters["General"]["domain"].as<std::string>();
+      // optional sequential stopping: the episodes stop once the confidence sequence of the mean discounted return of the agent to control
+      // is narrower than halfWidth, after at least minimumEpisodes and at most repeat episodes. the rule is checked in the order of the episodes,
+      // so where it stops does not depend on the number of workers. shards run all of their episodes, the rule is applied when they are merged
+      YAML::Node stoppingParameters = parameters["Experiment"]["stopping"];
+      sequentialStopping = stoppingParameters.IsDefined() && shard.count == 1;
+      targetHalfWidth = sequentialStopping ? stoppingParameters["halfWidth"].as<double>() : 0.0;
+      confidence = sequentialStopping && stoppingParameters["confidence"].IsDefined() ? stoppingParameters["confidence"].as<double>() : 0.95;
+      minimumEpisodes = sequentialStopping && stoppingParameters["minimumEpisodes"].IsDefined() ? stoppingParameters["minimumEpisodes"].as<int>() : 30;
+
+      // results are recorded in the order of the episodes, an episode is recorded once all episodes before it have finished
+      resultsOfEpisodes = std::vector<EpisodeMetrics>(numOfRepeats);
+      finished = std::vector<bool>(numOfRepeats, false);
+      for (auto &[episodeID, results]: records->getFinishedEpisodes()) {
+        if (episodeID <= numOfRepeats-1 && shard.contains(episodeID)) {
+          resultsOfEpisodes[episodeID] = EpisodeMetrics(agentComponentPtrs[0]->getAgentIDs(), results);
+          finished[episodeID] = true;
+        }
+      }
+      // resumed episodes at the start
+      recordFinishedEpisodes();
+    }
 
-      int numOfRepeats = parameters["Experiment"]["repeat"].as<int>();
+    // runs episode i with the agent component and the environment of a free worker, safe to call from the threads of a parallel region
+    void runEpisode(int i) {
+      // episodes after the stopping point are skipped, those already running when it is reached are not recorded
+      if (shard.contains(i) == false || records->getFinishedEpisodes().count(i) != 0 || stopped == true) {
+        return;
+      }
+      int worker;
+      {
+        std::lock_guard<std::mutex> lock(episodeMutex);
+        worker = freeWorkers.back();
+        freeWorkers.pop_back();
+      }
+      auto results = playEpisode(i, worker);
 
-      Domain *domainPtr = makeDomain(domainName);
-      // create an agent component
-      AgentComponent *agentComponentPtr = makeAgentComponent(domainPtr);
-      // create an environment
-      Domain::Environment *environmentPtr = domainPtr->makeEnvironment();
+      std::lock_guard<std::mutex> lock(episodeMutex);
+      freeWorkers.push_back(worker);
+      recordResults(i, std::move(results));
+    }
 
-      // to store moving average of episodic returns
-      std::vector<float> movingAverages;
-      std::vector<float> secondPerAction;
+    // writes the results once the episodes have been run
+    void finish() {
+      // resumed episodes that are not followed by a new episode
+      recordFinishedEpisodes();
+
+      if (sequentialStopping == true) {
+        YAML::Node stoppingYAML;
+        stoppingYAML["reason"] = stoppingReason;
+        stoppingYAML["numberOfEpisodes"] = numberOfRecordedEpisodes;
+        stoppingYAML["meanReturn"] = returnStatistics.mean;
+        stoppingYAML["halfWidth"] = returnStatistics.count >= 2 ? returnStatistics.confidenceSequenceHalfWidth(confidence, minimumEpisodes) : std::numeric_limits<double>::infinity();
+        stoppingYAML["confidence"] = confidence;
+        LOG(INFO) << "Stopped after " << numberOfRecordedEpisodes << " episodes (" << stoppingReason << "), mean discounted return " << returnStatistics.mean << " +- " << stoppingYAML["halfWidth"].as<double>() << ".";
+        std::ofstream stoppingYAMLFile(pathToResultsFolder+"/stopping.yaml");
+        stoppingYAMLFile << stoppingYAML;
+      }
 
-      for (int i=0; i<=numOfRepeats-1; i++){
-        
-        resultsYAML[std::to_string(i)] = YAML::Node();
-
-        std::string prefix = "[Episode " + std::to_string(i) + "] ";
-        // run an episode
-        Episode episode = Episode(i, environmentPtr, agentComponentPtr, parameters["General"]["horizon"].as<int>(), parameters["General"]["discountFactor"].as<float>(), pathToResultsFolder, parameters["Experiment"]["saveReplay"].as<bool>());
-        // auto results = episode.run();
-        auto results = episode.dispatch();
-        // logging
-        for (int j=0; j<=domainPtr->getNumberOfAgents()-1; j++){
-          auto &agentID = domainPtr->getListOfAgentIDs()[j];
-          float episodic_return = results["discounted_episodic_return"][agentID][0];
-
-          if ((fullLogging == true) || (agentID == IDOfAgentToControl)) {
-            resultsYAML[i][agentID]["Return"] = episodic_return;
-            resultsYAML[i][agentID]["Times"] = results["time_per_action"][agentID];
-            if (agentID == IDOfAgentToControl) {
-              resultsYAML[i][agentID]["Num_simulations"] = results["number_of_simulations_per_step"][agentID];
-              resultsYAML[i][agentID]["Num_particles"] = results["number_of_particles_before_simulation"][agentID];
-            }
-          }
-          
-          std::string returnMessage;
-          returnMessage =  prefix + "Agent " + agentID + " Discounted Episodic Return: " + std::to_string(episodic_return);
-            
-          std::string movingAvgMessage;
-          if (movingAverages.size() < domainPtr->getNumberOfAgents()) {
-            movingAverages.push_back(episodic_return);
-          } else {
-            movingAverages[j] = (movingAverages[j] * i + episodic_return) / (i+1);
-          }
-          movingAvgMessage = prefix + "Agent " + agentID + " Moving Average of discounted returns: " + std::to_string(movingAverages[j]);
+      std::ofstream resultsYAMLFile;
+      resultsYAMLFile.open(pathToResultsFolder+"/results.yaml");
+      resultsYAMLFile << resultsYAML;
+      resultsYAMLFile.close();
+    }
 
-          std::string timeMessage; 
-          timeMessage = prefix + "Agent " + agentID + " Average Decision Making Time Per Step: ";
-          double totalTime = 0.0;
-          for (auto &time: results["time_per_action"][agentID]) {
-            totalTime += time;
-          }
-          timeMessage += std::to_string(totalTime / results["time_per_action"][agentID].size());
+    // resources of an earlier run of the same configuration, to be set before the experiment is run
+    void setResources(const std::shared_ptr<PlanningResources> &resources) {
+      this->resources = resources;
+    }
 
-          std::string simMessage;
-          simMessage = prefix + "Agent " + agentID + " Number of simulations Per Step: ";
-          double totalSims = 0.0;
-          for (auto &sim: results["number_of_simulations_per_step"][agentID]) {
-            totalSims += sim;
-          }
-          simMessage += std::to_string(totalSims / results["number_of_simulations_per_step"][agentID].size());
+    std::shared_ptr<PlanningResources> getResources() {
+      return resources;
+    }
 
-          std::string particleMessage;
-          particleMessage = prefix + "Agent " + agentID + " Number of particles before simulation Per Step: ";
-          double totalParticles = 0.0;
-          for (auto &particle: results["number_of_particles_before_simulation"][agentID]) {
-            totalParticles += particle;
-          }
-          particleMessage += std::to_string(totalParticles / results["number_of_particles_before_simulation"][agentID].size());
+    int getNumberOfEpisodes() {
+      return numOfRepeats;
+    }
 
-          if (agentID == IDOfAgentToControl) {
-            LOG(INFO) << returnMessage;
-            LOG(INFO) << movingAvgMessage;
-            LOG(INFO) << timeMessage;
-            LOG(INFO) << simMessage;
-            LOG(INFO) << particleMessage;
-          } else {
-            VLOG(1) << returnMessage;
-            VLOG(1) << movingAvgMessage;
-            VLOG(1) << timeMessage;
-            VLOG(1) << simMessage;
-            VLOG(1) << particleMessage;
-          }
-          
-        }
+    // a rough estimate of the processor time of an episode, to schedule costly episodes before cheap ones
+    double estimateSecondsPerEpisode() {
+      YAML::Node rollout = parameters["AgentComponent"][IDOfAgentToControl]["Rollout"];
+      if (rollout["numberOfSecondsPerStep"].IsDefined()) {
+        return horizon * rollout["numberOfSecondsPerStep"].as<double>();
+      } else if (rollout["numberOfSimulationsPerStep"].IsDefined()) {
+        // about a microsecond per simulated step of an agent
+        return horizon * rollout["numberOfSimulationsPerStep"].as<double>() * domainPtr->getNumberOfAgents() * 1e-6;
+      }
+      return horizon * domainPtr->getNumberOfAgents() * 1e-6;
+    }
 
+  private:
+    Shard shard;
+    bool fullLogging;
+    std::string IDOfAgentToControl;
+    int numOfRepeats;
+    int horizon;
+    float discountFactor;
+    bool saveReplay;
+    int numberOfWorkers;
+    unsigned int seed;
+
+    std::shared_ptr<PlanningResources> resources;
+    Domain *domainPtr = nullptr;
+    std::vector<AgentComponent*> agentComponentPtrs;
+    std::vector<Domain::Environment*> environmentPtrs;
+    std::vector<int> freeWorkers;
+    std::unique_ptr<EpisodeRecords> records;
+
+    bool sequentialStopping;
+    double targetHalfWidth;
+    double confidence;
+    int minimumEpisodes;
+    RunningStatistics returnStatistics;
+    std::atomic<bool> stopped{false};
+    std::string stoppingReason = "maximumEpisodes";
+
+    YAML::Node resultsYAML;
+    // to store moving average of episodic returns
+    std::vector<float> movingAverages;
+    std::vector<EpisodeMetrics> resultsOfEpisodes;
+    std::vector<bool> finished;
+    int numberOfRecordedEpisodes = 0;
+    int nextEpisodeID = 0;
+    std::mutex episodeMutex;
+
+    // plays episode i with the agent component and the environment of a worker
+    EpisodeMetrics playEpisode(int i, int worker) {
+      // separate seeds for the environment, the agents and the random number generator of the thread
+      std::seed_seq sequence{seed, (unsigned int)i};
+      std::vector<unsigned int> seeds(3);
+      sequence.generate(seeds.begin(), seeds.end());
+      environmentPtrs[worker]->seed(seeds[0]);
+      agentComponentPtrs[worker]->seed(seeds[1]);
+      std::experimental::reseed(seeds[2]);
+
+      // run an episode
+      Episode episode = Episode(i, environmentPtrs[worker], agentComponentPtrs[worker], horizon, discountFactor, pathToResultsFolder, saveReplay);
+      return episode.dispatch();
+    }
 
+    void recordResults(int i, EpisodeMetrics &&results) {
+      records->write(i, seed, results.toResults());
+      resultsOfEpisodes[i] = std::move(results);
+      finished[i] = true;
+      recordFinishedEpisodes();
+    }
+
+    // the episodes are played by forked processes, which inherit the domain and the agent component copy-on-write,
+    // and their results are recorded by this process
+    void runEpisodesInProcesses() {
+      int nextEpisodeToRun = 0;
+      auto nextTask = [&](int &i) {
+        while (nextEpisodeToRun <= numOfRepeats-1 && (shard.contains(nextEpisodeToRun) == false || records->getFinishedEpisodes().count(nextEpisodeToRun) != 0)) {
+          nextEpisodeToRun += 1;
+        }
+        if (stopped == true || nextEpisodeToRun > numOfRepeats-1) {
+          return false;
+        }
+        i = nextEpisodeToRun;
+        nextEpisodeToRun += 1;
+        return true;
+      };
+      ProcessPool pool(numberOfWorkers, [&](int i) {
+        nlohmann::json results = playEpisode(i, 0).toResults();
+        return results.dump();
+      });
+      pool.run(nextTask, [&](int i, const std::string &message) {
+        recordResults(i, EpisodeMetrics(agentComponentPtrs[0]->getAgentIDs(), nlohmann::json::parse(message).get<EpisodeRecords::Results>()));
+      });
+    }
 
+    void recordFinishedEpisodes() {
+      // the episodes of other shards are passed over
+      while (stopped == false && nextEpisodeID <= numOfRepeats-1 && (finished[nextEpisodeID] == true || shard.contains(nextEpisodeID) == false)) {
+        if (shard.contains(nextEpisodeID) == true) {
+          recordEpisode(nextEpisodeID, resultsOfEpisodes[nextEpisodeID]);
+          resultsOfEpisodes[nextEpisodeID] = EpisodeMetrics();
+          numberOfRecordedEpisodes += 1;
+        }
+        nextEpisodeID += 1;
       }
+    }
 
-      std::ofstream resultsYAMLFile;
-      resultsYAMLFile.open(pathToResultsFolder+"/results.yaml");
-      resultsYAMLFile << resultsYAML;
-      resultsYAMLFile.close();
+    void recordEpisode(int i, const EpisodeMetrics &metrics) {
+      resultsYAML[std::to_string(i)] = YAML::Node();
 
-      delete domainPtr;
-      delete agentComponentPtr;
-      delete environmentPtr;
+      std::string prefix = "[Episode " + std::to_string(i) + "] ";
+      // logging
+      for (int j=0; j<=domainPtr->getNumberOfAgents()-1; j++){
+        auto &agentID = domainPtr->getListOfAgentIDs()[j];
+        int slot = metrics.getSlot(agentID);
+        float episodic_return = metrics.get(DISCOUNTED_EPISODIC_RETURN, slot)[0];
 
-      return true;
-  }
+        if ((fullLogging == true) || (agentID == IDOfAgentToControl)) {
+          resultsYAML[i][agentID]["Return"] = episodic_return;
+          resultsYAML[i][agentID]["Times"] = metrics.get(TIME_PER_ACTION, slot);
+          if (agentID == IDOfAgentToControl) {
+            resultsYAML[i][agentID]["Num_simulations"] = metrics.get(NUMBER_OF_SIMULATIONS_PER_STEP, slot);
+            resultsYAML[i][agentID]["Num_particles"] = metrics.get(NUMBER_OF_PARTICLES_BEFORE_SIMULATION, slot);
+          }
+        }
+        
+        std::string returnMessage;
+        returnMessage =  prefix + "Agent " + agentID + " Discounted Episodic Return: " + std::to_string(episodic_return);
+          
+        std::string movingAvgMessage;
+        if ((int)movingAverages.size() < domainPtr->getNumberOfAgents()) {
+          movingAverages.push_back(episodic_return);
+        } else {
+          movingAverages[j] = (movingAverages[j] * numberOfRecordedEpisodes + episodic_return) / (numberOfRecordedEpisodes+1);
+        }
+        movingAvgMessage = prefix + "Agent " + agentID + " Moving Average of discounted returns: " + std::to_string(movingAverages[j]);
+
+        std::string timeMessage; 
+        timeMessage = prefix + "Agent " + agentID + " Average Decision Making Time Per Step: ";
+        timeMessage += std::to_string(metrics.getStatistics(TIME_PER_ACTION, slot).mean);
+
+        std::string simMessage;
+        simMessage = prefix + "Agent " + agentID + " Number of simulations Per Step: ";
+        simMessage += std::to_string(metrics.getStatistics(NUMBER_OF_SIMULATIONS_PER_STEP, slot).mean);
+
+        std::string particleMessage;
+        particleMessage = prefix + "Agent " + agentID + " Number of particles before simulation Per Step: ";
+        particleMessage += std::to_string(metrics.getStatistics(NUMBER_OF_PARTICLES_BEFORE_SIMULATION, slot).mean);
+
+        if (agentID == IDOfAgentToControl) {
+          LOG(INFO) << returnMessage;
+          LOG(INFO) << movingAvgMessage;
+          LOG(INFO) << timeMessage;
+          LOG(INFO) << simMessage;
+          LOG(INFO) << particleMessage;
+        } else {
+          VLOG(1) << returnMessage;
+          VLOG(1) << movingAvgMessage;
+          VLOG(1) << timeMessage;
+          VLOG(1) << simMessage;
+          VLOG(1) << particleMessage;
+        }
+        
+      }
+
+      returnStatistics.add(metrics.get(DISCOUNTED_EPISODIC_RETURN, metrics.getSlot(IDOfAgentToControl))[0]);
+      if (sequentialStopping == true && returnStatistics.count >= minimumEpisodes) {
+        double halfWidth = returnStatistics.confidenceSequenceHalfWidth(confidence, minimumEpisodes);
+        VLOG(1) << prefix << "Half width of the confidence sequence of the mean discounted return: " << halfWidth;
+        if (halfWidth <= targetHalfWidth) {
+          stoppingReason = "halfWidth";
+          stopped = true;
+        }
+      }
+    }
 
 };
 
@@ -0,0 +1,65 @@
+// merges the shards of a planning experiment, run with --shard index/count, into the results of a single run
+// the records of the shards under shards/ in the results folder are collected into results.jsonl, and the experiment is resumed from them,
+// so results.yaml and stopping.yaml are written as by a single run of all episodes. the configuration is that of the planning experiment
+
+#include "Experiment.hpp"
+#include <filesystem>
+
+class MergeExperiment: public Experiment {
+
+  public:
+
+    MergeExperiment(std::string pathToConfigurationFile, std::string pathToResultsFolder):Experiment(pathToConfigurationFile, pathToResultsFolder){};
+
+    bool run(){
+
+      int numOfRepeats = parameters["Experiment"]["repeat"].as<int>();
+
+      // the records of all shards
+      std::map<int, EpisodeRecords::Results> finishedEpisodes;
+      std::map<int, std::string> lines;
+      std::set<unsigned int> seeds;
+      std::set<std::string> shardFolders;
+      std::string pathToShardsFolder = pathToResultsFolder + "/shards";
+      if (std::filesystem::is_directory(pathToShardsFolder) == false) {
+        throw std::invalid_argument("there are no shards in " + pathToShardsFolder + ".");
+      }
+      for (auto &entry: std::filesystem::directory_iterator(pathToShardsFolder)) {
+        shardFolders.insert(entry.path().string());
+      }
+      for (auto &shardFolder: shardFolders) {
+        std::map<int, std::string> linesOfShard;
+        EpisodeRecords::read(shardFolder + "/results.jsonl", finishedEpisodes, linesOfShard, seeds);
+        LOG(INFO) << "[Merge] " << linesOfShard.size() << " episodes are read from " << shardFolder << ".";
+        lines.insert(linesOfShard.begin(), linesOfShard.end());
+      }
+
+      int numberOfMissingEpisodes = 0;
+      for (int i=0; i<=numOfRepeats-1; i++) {
+        numberOfMissingEpisodes += lines.count(i) == 0 ? 1 : 0;
+      }
+      if (numberOfMissingEpisodes > 0) {
+        throw std::runtime_error(std::to_string(numberOfMissingEpisodes) + " of " + std::to_string(numOfRepeats) + " episodes are missing in the shards of " + pathToResultsFolder + ".");
+      }
+      if (seeds.size() != 1) {
+        throw std::runtime_error("the shards of " + pathToResultsFolder + " were run with " + std::to_string(seeds.size()) + " different seeds.");
+      }
+
+      std::ofstream recordsFile(pathToResultsFolder + "/results.jsonl", std::ios::trunc);
+      for (auto &[episodeID, line]: lines) {
+        if (episodeID <= numOfRepeats-1) {
+          recordsFile << line << "\n";
+        }
+      }
+      recordsFile.close();
+      LOG(INFO) << "[Merge] " << numOfRepeats << " episodes of " << shardFolders.size() << " shards are merged.";
+
+      // every episode is found in the records, so none is run again
+      YAML::Node mergedParameters = YAML::Clone(parameters);
+      mergedParameters["Experiment"]["resume"] = true;
+      mergedParameters["Experiment"]["numberOfWorkers"] = 1;
+      PlanningExperiment experiment(mergedParameters, pathToResultsFolder);
+      return experiment.run();
+    }
+
+};
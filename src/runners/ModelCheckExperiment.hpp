@@ -0,0 +1,204 @@
+// statistical check of the native model of a domain against its DBN
+// both models are stepped from the same sampled states and actions, and for every sampled variable the frequencies of its values
+// given its parents are compared with a two proportion z-test
+
+#include "Experiment.hpp"
+#include <chrono>
+#include "Utils.hpp"
+
+class ModelCheckExperiment: public Experiment {
+
+  public:
+
+    ModelCheckExperiment(std::string pathToConfigurationFile, std::string pathToResultsFolder):Experiment(pathToConfigurationFile, pathToResultsFolder){};
+
+    bool run(){
+
+      // read configurations
+      std::string domainName = parameters["General"]["domain"].as<std::string>();
+      std::string agentID = parameters["General"]["IDOfAgentToControl"].as<std::string>();
+      int numberOfSamples = parameters["Experiment"]["numberOfSamples"].IsDefined() ? parameters["Experiment"]["numberOfSamples"].as<int>() : 10000;
+      float maximumZScore = parameters["Experiment"]["maximumZScore"].IsDefined() ? parameters["Experiment"]["maximumZScore"].as<float>() : 5.0;
+
+      // set up the domain
+      Domain *domainPtr = makeDomain(domainName);
+      TwoStageDynamicBayesianNetwork *DBNPtr = domainPtr->getDBNPtr();
+      if (domainPtr->usesNativeModel() == false) {
+        LOG(WARNING) << "[Model Check] " << domainName << " steps the DBN, the DBN is compared with itself.";
+      }
+      std::vector<std::string> localFactors, localStates, sourceFactors, destinationFactors, dSeparationSetPerStage;
+      DBNPtr->constructLocalModel(agentID, localFactors, localStates, sourceFactors, destinationFactors, dSeparationSetPerStage);
+      std::vector<std::string> localOutputs; // the variables sampled by the local model
+
+      Domain::SimulationContext simulationContext;
+      std::default_random_engine &randomNumberGenerator = simulationContext.randomNumberGenerator;
+      ModelCounts globalCounts(DBNPtr);
+      ModelCounts localCounts(DBNPtr);
+      double DBNGlobalTime = 0.0;
+      double nativeGlobalTime = 0.0;
+      for (int i=0; i<=numberOfSamples-1; i++) {
+        // a sampled state with uniformly random actions
+        std::map<std::string, int> initialState = DBNPtr->sampleInitialState(randomNumberGenerator);
+        for (auto &[ID, numberOfActions]: domainPtr->getAgentsSpecification()) {
+          initialState["a"+ID] = std::uniform_int_distribution<int>(0, numberOfActions-1)(randomNumberGenerator);
+        }
+        std::vector<int> denseState = DBNPtr->toDenseState(initialState);
+
+        // the full model
+        std::vector<int> DBNState = denseState;
+        auto begin = std::chrono::steady_clock::now();
+        DBNPtr->step(DBNState, "full", randomNumberGenerator);
+        DBNGlobalTime += std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+        std::vector<int> nativeState = denseState;
+        begin = std::chrono::steady_clock::now();
+        domainPtr->stepGlobal(nativeState, simulationContext);
+        nativeGlobalTime += std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+        globalCounts.add(0, denseState, DBNState);
+        globalCounts.add(1, denseState, nativeState);
+
+        // the local model of the agent to control
+        std::map<std::string, int> DBNLocalState = initialState;
+        DBNPtr->step(DBNLocalState, "local", randomNumberGenerator);
+        std::map<std::string, int> nativeLocalState = initialState;
+        domainPtr->stepLocal(agentID, nativeLocalState, simulationContext);
+        if (localOutputs.size() == 0) {
+          for (auto &[key, val]: DBNLocalState) {
+            if (ModelCounts::isSampled(key) == true) {
+              localOutputs.push_back(key);
+            }
+          }
+        }
+        localCounts.add(0, denseState, DBNPtr->toDenseState(DBNLocalState), localOutputs);
+        localCounts.add(1, denseState, DBNPtr->toDenseState(nativeLocalState), localOutputs);
+      }
+
+      // compare the frequencies
+      YAML::Node resultsYAML;
+      bool passed = true;
+      for (auto &[model, countsPtr]: std::map<std::string, ModelCounts*>{{"full", &globalCounts}, {"local", &localCounts}}) {
+        std::string worstVariable;
+        int numberOfTests = 0;
+        double largestZScore = countsPtr->compare(worstVariable, numberOfTests);
+        passed = passed && (largestZScore <= maximumZScore);
+        resultsYAML[model]["numberOfTests"] = numberOfTests;
+        resultsYAML[model]["largestZScore"] = largestZScore;
+        resultsYAML[model]["worstVariable"] = worstVariable;
+        LOG(INFO) << "[Model Check] " << model << " model: " << numberOfTests << " tests, largest z-score " << largestZScore << " (" << worstVariable << ").";
+      }
+      resultsYAML["numberOfSamples"] = numberOfSamples;
+      resultsYAML["DBNStepsPerSecond"] = numberOfSamples / DBNGlobalTime;
+      resultsYAML["nativeStepsPerSecond"] = numberOfSamples / nativeGlobalTime;
+      resultsYAML["passed"] = passed;
+      LOG(INFO) << "[Model Check] full steps per second: " << numberOfSamples / DBNGlobalTime << " (DBN), " << numberOfSamples / nativeGlobalTime << " (" << (domainPtr->usesNativeModel() ? "native" : "DBN") << ").";
+      if (passed == false) {
+        LOG(WARNING) << "[Model Check] the native model of " << domainName << " differs from the DBN.";
+      }
+
+      std::ofstream resultsYAMLFile;
+      resultsYAMLFile.open(pathToResultsFolder+"/results.yaml");
+      resultsYAMLFile << resultsYAML;
+      resultsYAMLFile.close();
+
+      delete domainPtr;
+
+      return passed;
+    }
+
+  private:
+    // counts of the values of sampled variables given their parents, for two models
+    class ModelCounts {
+      public:
+        ModelCounts(TwoStageDynamicBayesianNetwork *DBNPtr) {
+          for (int index=0; index<=DBNPtr->getNumberOfVariables()-1; index++) {
+            TwoStageDynamicBayesianNetworkVariable *variablePtr = DBNPtr->getVariable(index);
+            if (isSampled(variablePtr->name) == false) {
+              continue;
+            }
+            SampledVariable variable;
+            variable.index = index;
+            for (auto &parentName: variablePtr->getListOfParents()) {
+              // parents from the next stage are read after the step, the others before
+              variable.parentIndices.push_back(DBNPtr->getIndexOfVariable(parentName));
+              variable.parentsAfterStep.push_back(isSampled(parentName));
+            }
+            _variables[variablePtr->name] = variable;
+          }
+        }
+
+        // count all sampled variables, or only the given ones
+        void add(int model, const std::vector<int> &stateBefore, const std::vector<int> &stateAfter, const std::vector<std::string> &variableNames = {}) {
+          if (variableNames.size() == 0) {
+            for (auto &[name, variable]: _variables) {
+              add(model, variable, stateBefore, stateAfter);
+            }
+          } else {
+            for (auto &name: variableNames) {
+              add(model, _variables.at(name), stateBefore, stateAfter);
+            }
+          }
+        }
+
+        // the largest absolute z-score over all variables, parent values and values
+        double compare(std::string &worstVariable, int &numberOfTests) {
+          double largestZScore = 0.0;
+          for (auto &[name, variable]: _variables) {
+            for (auto &[parentValues, counts]: variable.counts) {
+              long total[2] = {0, 0};
+              for (int model=0; model<=1; model++) {
+                for (auto &count: counts[model]) {
+                  total[model] += count;
+                }
+              }
+              if (total[0] == 0 || total[1] == 0) {
+                continue;
+              }
+              for (int value=0; value<=(int)counts[0].size()-1; value++) {
+                double pooled = (double)(counts[0][value] + counts[1][value]) / (total[0] + total[1]);
+                numberOfTests += 1;
+                if (pooled == 0.0 || pooled == 1.0) {
+                  continue;
+                }
+                double difference = (double)counts[0][value] / total[0] - (double)counts[1][value] / total[1];
+                double zScore = std::abs(difference) / std::sqrt(pooled * (1.0 - pooled) * (1.0 / total[0] + 1.0 / total[1]));
+                if (zScore > largestZScore) {
+                  largestZScore = zScore;
+                  std::vector<int> conditionalValues = parentValues;
+                  worstVariable = name + PrintUtils::vectorToTupleString(conditionalValues) + "=" + std::to_string(value);
+                }
+              }
+            }
+          }
+          return largestZScore;
+        }
+
+        // variables of the next stage, sampled by a step
+        static bool isSampled(const std::string &name) {
+          return name[0] == 'o' || name[0] == 'r' || StringUtils::lastBitIsPrime(name);
+        }
+
+      private:
+        struct SampledVariable {
+          int index;
+          std::vector<int> parentIndices;
+          std::vector<bool> parentsAfterStep;
+          std::map<std::vector<int>, std::array<std::vector<long>, 2>> counts;
+        };
+        std::map<std::string, SampledVariable> _variables;
+
+
+        void add(int model, SampledVariable &variable, const std::vector<int> &stateBefore, const std::vector<int> &stateAfter) {
+          std::vector<int> parentValues;
+          for (int i=0; i<=(int)variable.parentIndices.size()-1; i++) {
+            parentValues.push_back(variable.parentsAfterStep[i] ? stateAfter[variable.parentIndices[i]] : stateBefore[variable.parentIndices[i]]);
+          }
+          std::array<std::vector<long>, 2> &counts = variable.counts[parentValues];
+          int value = stateAfter[variable.index];
+          if (value >= (int)counts[model].size()) {
+            counts[0].resize(value+1, 0);
+            counts[1].resize(value+1, 0);
+          }
+          counts[model][value] += 1;
+        }
+    };
+
+};
@@ -0,0 +1,240 @@
+#ifndef PROCESS_POOL_HPP_
+#define PROCESS_POOL_HPP_
+
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <atomic>
+#include <cerrno>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "glog/logging.h"
+
+// a pool of worker processes forked from the calling process, so that everything loaded before the pool is started
+// (the domain, the DBN, the influence predictors) is shared copy-on-write instead of being loaded by every worker
+// tasks are integers sent to idle workers over a pipe, every task is answered with a string over a second pipe
+class ProcessPool {
+  public:
+    typedef std::function<std::string(int)> Work;
+
+    // forks the workers, which run work on every task they receive until the pool is closed
+    ProcessPool(int numberOfProcesses, const Work &work) {
+      if (threadsStarted() == true) {
+        throw std::runtime_error("worker processes cannot be forked from a process that has run OpenMP or libtorch threads, which do not survive a fork. run the experiment in a process of its own or with worker threads.");
+      }
+      for (int p=0; p<=numberOfProcesses-1; p++) {
+        int taskPipe[2], resultPipe[2];
+        if (pipe(taskPipe) != 0 || pipe(resultPipe) != 0) {
+          throw std::runtime_error("cannot create the pipes of a worker process.");
+        }
+        // buffered logs would otherwise be written again by the worker
+        google::FlushLogFiles(google::GLOG_INFO);
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid < 0) {
+          throw std::runtime_error("cannot fork a worker process.");
+        }
+        if (pid == 0) {
+          ::close(taskPipe[1]);
+          ::close(resultPipe[0]);
+          for (auto &worker: _workers) {
+            ::close(worker.taskFileDescriptor);
+            ::close(worker.resultFileDescriptor);
+          }
+          closeInheritedPipesAndSockets(taskPipe[0], resultPipe[1]);
+          serve(taskPipe[0], resultPipe[1], work);
+        }
+        ::close(taskPipe[0]);
+        ::close(resultPipe[1]);
+        _workers.push_back({pid, taskPipe[1], resultPipe[0], -1});
+      }
+      // a worker that exits while a task is sent is reported by the write instead of a signal
+      signal(SIGPIPE, SIG_IGN);
+    }
+
+    ~ProcessPool() {
+      close();
+    }
+
+    // the thread pools of OpenMP and the intra-op threads of libtorch are not usable in a forked child, and a parallel region there can hang
+    // callers mark every parallel region they open, pools are refused afterwards
+    static void markThreadsStarted() {
+      threadsStarted() = true;
+    }
+
+    // runs tasks until nextTask returns false and every task sent has been answered
+    // onResult is called in the calling process, in the order the results arrive
+    void run(const std::function<bool(int&)> &nextTask, const std::function<void(int, const std::string&)> &onResult) {
+      bool moreTasks = true;
+      for (auto &worker: _workers) {
+        moreTasks = moreTasks && sendNextTask(worker, nextTask);
+      }
+      std::vector<pollfd> fileDescriptors(_workers.size());
+      while (true) {
+        int numberOfBusyWorkers = 0;
+        for (int w=0; w<=(int)_workers.size()-1; w++) {
+          fileDescriptors[w] = {_workers[w].resultFileDescriptor, POLLIN, 0};
+          numberOfBusyWorkers += _workers[w].task >= 0 ? 1 : 0;
+        }
+        if (numberOfBusyWorkers == 0) {
+          break;
+        }
+        if (poll(fileDescriptors.data(), fileDescriptors.size(), -1) < 0) {
+          if (errno == EINTR) {
+            continue;
+          }
+          throw std::runtime_error("cannot wait for the worker processes.");
+        }
+        for (int w=0; w<=(int)_workers.size()-1; w++) {
+          if (fileDescriptors[w].revents == 0 || _workers[w].task < 0) {
+            continue;
+          }
+          int task = _workers[w].task;
+          std::string result;
+          if (receive(_workers[w].resultFileDescriptor, result) == false) {
+            throw std::runtime_error("worker process " + std::to_string(_workers[w].pid) + " exited during task " + std::to_string(task) + ".");
+          }
+          _workers[w].task = -1;
+          onResult(task, result);
+          moreTasks = moreTasks && sendNextTask(_workers[w], nextTask);
+        }
+      }
+    }
+
+    // stops the workers and waits for them to exit
+    void close() {
+      for (auto &worker: _workers) {
+        ::close(worker.taskFileDescriptor);
+        ::close(worker.resultFileDescriptor);
+      }
+      for (auto &worker: _workers) {
+        int status;
+        if (waitpid(worker.pid, &status, 0) < 0 || WIFEXITED(status) == false || WEXITSTATUS(status) != 0) {
+          LOG(WARNING) << "[Process Pool] worker process " << worker.pid << " exited abnormally.";
+        }
+      }
+      _workers.clear();
+    }
+
+  private:
+    static std::atomic<bool> &threadsStarted() {
+      static std::atomic<bool> started(false);
+      return started;
+    }
+
+    struct Worker {
+      pid_t pid;
+      int taskFileDescriptor;
+      int resultFileDescriptor;
+      int task; // the task the worker is running, -1 if it is idle
+    };
+    std::vector<Worker> _workers;
+
+    bool sendNextTask(Worker &worker, const std::function<bool(int&)> &nextTask) {
+      int task;
+      if (nextTask(task) == false) {
+        return false;
+      }
+      if (writeFully(worker.taskFileDescriptor, &task, sizeof(task)) == false) {
+        throw std::runtime_error("worker process " + std::to_string(worker.pid) + " does not accept tasks.");
+      }
+      worker.task = task;
+      return true;
+    }
+
+    // a worker does not hold the other pipes and sockets of the parent open, such as the socket of a server, so their readers see them close
+    // a fork does not honour close-on-exec, so they are closed here. the standard streams and the log files stay open
+    static void closeInheritedPipesAndSockets(int taskFileDescriptor, int resultFileDescriptor) {
+      std::vector<int> fileDescriptors;
+      DIR *directory = opendir("/proc/self/fd");
+      if (directory == nullptr) {
+        return;
+      }
+      while (dirent *entry = readdir(directory)) {
+        if (entry->d_name[0] != '.') {
+          fileDescriptors.push_back(atoi(entry->d_name));
+        }
+      }
+      closedir(directory);
+      for (int fileDescriptor: fileDescriptors) {
+        struct stat fileStat;
+        if (fileDescriptor <= 2 || fileDescriptor == taskFileDescriptor || fileDescriptor == resultFileDescriptor || fstat(fileDescriptor, &fileStat) != 0) {
+          continue;
+        }
+        if (S_ISFIFO(fileStat.st_mode) || S_ISSOCK(fileStat.st_mode)) {
+          ::close(fileDescriptor);
+        }
+      }
+    }
+
+    // the loop of a worker process, which exits once the task pipe is closed
+    [[noreturn]] static void serve(int taskFileDescriptor, int resultFileDescriptor, const Work &work) {
+      int task;
+      while (readFully(taskFileDescriptor, &task, sizeof(task)) == true) {
+        std::string result;
+        try {
+          result = work(task);
+        } catch (const std::exception &e) {
+          LOG(ERROR) << "[Process Pool] task " << task << " failed: " << e.what();
+          google::FlushLogFiles(google::GLOG_INFO);
+          _exit(1);
+        }
+        size_t size = result.size();
+        if (writeFully(resultFileDescriptor, &size, sizeof(size)) == false || writeFully(resultFileDescriptor, result.data(), size) == false) {
+          _exit(1);
+        }
+      }
+      // the worker leaves without the destructors and exit handlers of the parent's objects
+      google::FlushLogFiles(google::GLOG_INFO);
+      _exit(0);
+    }
+
+    static bool receive(int fileDescriptor, std::string &result) {
+      size_t size;
+      if (readFully(fileDescriptor, &size, sizeof(size)) == false) {
+        return false;
+      }
+      result.resize(size);
+      return readFully(fileDescriptor, result.data(), size);
+    }
+
+    static bool readFully(int fileDescriptor, void *buffer, size_t size) {
+      char *position = static_cast<char*>(buffer);
+      while (size > 0) {
+        ssize_t count = read(fileDescriptor, position, size);
+        if (count < 0 && errno == EINTR) {
+          continue;
+        }
+        if (count <= 0) {
+          return false;
+        }
+        position += count;
+        size -= count;
+      }
+      return true;
+    }
+
+    static bool writeFully(int fileDescriptor, const void *buffer, size_t size) {
+      const char *position = static_cast<const char*>(buffer);
+      while (size > 0) {
+        ssize_t count = write(fileDescriptor, position, size);
+        if (count < 0 && errno == EINTR) {
+          continue;
+        }
+        if (count <= 0) {
+          return false;
+        }
+        position += count;
+        size -= count;
+      }
+      return true;
+    }
+};
+
+#endif
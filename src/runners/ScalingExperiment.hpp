@@ -0,0 +1,165 @@
+// how the simulators and planners scale with the number of agents
+// for every number of agents an instance of the domain is generated, and the global simulator is compared with the influence augmented
+// local simulator by steps per second, by POMCP simulations per second and by the memory of the process
+//
+// Experiment:
+//   numbersOfAgents: [5, 17, 65, 257, 1025, 4097]
+//   numberOfSimulatorSteps: 10000
+//   otherAgents: {Type: Count, memorySize: -1}                         # the agents that are not planning
+//   localSimulator: {InfluencePredictor: {Type: Random, recurrent: true}}
+// the domain section holds the generate section without the number of agents, the agent to control holds the POMCP parameters
+
+#include "Experiment.hpp"
+#include <chrono>
+#include "Utils.hpp"
+
+class ScalingExperiment: public Experiment {
+
+  public:
+
+    ScalingExperiment(std::string pathToConfigurationFile, std::string pathToResultsFolder):Experiment(pathToConfigurationFile, pathToResultsFolder){};
+
+    bool run(){
+
+      // read configurations
+      std::string domainName = parameters["General"]["domain"].as<std::string>();
+      std::string agentID = parameters["General"]["IDOfAgentToControl"].as<std::string>();
+      int horizon = parameters["General"]["horizon"].as<int>();
+      float discountFactor = parameters["General"]["discountFactor"].as<float>();
+      std::vector<int> numbersOfAgents = parameters["Experiment"]["numbersOfAgents"].IsDefined() ? parameters["Experiment"]["numbersOfAgents"].as<std::vector<int>>() : std::vector<int>{5, 17, 65, 257, 1025, 4097};
+      int numberOfSimulatorSteps = parameters["Experiment"]["numberOfSimulatorSteps"].IsDefined() ? parameters["Experiment"]["numberOfSimulatorSteps"].as<int>() : 10000;
+      YAML::Node otherAgentParameters = parameters["Experiment"]["otherAgents"].IsDefined() ? parameters["Experiment"]["otherAgents"] : YAML::Load("{Type: Random}");
+      YAML::Node localSimulatorParameters = parameters["Experiment"]["localSimulator"].IsDefined() ? parameters["Experiment"]["localSimulator"] : YAML::Load("{InfluencePredictor: {Type: Random, recurrent: true}}");
+      YAML::Node plannerParameters = parameters["AgentComponent"][agentID];
+
+      YAML::Node resultsYAML;
+      for (auto &numberOfAgents: numbersOfAgents) {
+        // generate the instance, the other agents are read off its actions
+        YAML::Node instanceParameters = YAML::Clone(parameters);
+        auto begin = std::chrono::steady_clock::now();
+        instanceParameters[domainName]["generate"]["numberOfAgents"] = numberOfAgents;
+        instanceParameters[domainName]["network"] = generateNetwork(domainName, instanceParameters[domainName]);
+        YAML::Node agentComponent;
+        for (YAML::const_iterator it = instanceParameters[domainName]["network"].begin(); it != instanceParameters[domainName]["network"].end(); it++) {
+          std::string name = it->first.as<std::string>();
+          if (name[0] == 'a') {
+            agentComponent.force_insert(name.substr(1), name.substr(1) == agentID ? plannerParameters : otherAgentParameters);
+          }
+        }
+        instanceParameters["AgentComponent"] = agentComponent;
+        Domain *domainPtr = makeDomain(domainName, instanceParameters);
+        int numberOfActions = domainPtr->getAgentsSpecification().at(agentID);
+        double constructionTime = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+        LOG(INFO) << "[Scaling] " << domainPtr->getNumberOfAgents() << " agents and " << domainPtr->getDBNPtr()->getNumberOfVariables() << " variables built in " << constructionTime << " seconds.";
+
+        // simulator steps
+        Domain::SingleAgentGlobalSimulator globalSimulator(agentID, domainPtr, agentComponent);
+        double globalStepsPerSecond = measureStepsPerSecond(globalSimulator, numberOfActions, horizon, numberOfSimulatorSteps);
+        Domain::SingleAgentRecurrentInfluenceAugmentedSimulator localSimulator(agentID, domainPtr, localSimulatorParameters);
+        double localStepsPerSecond = measureStepsPerSecond(localSimulator, numberOfActions, horizon, numberOfSimulatorSteps);
+
+        // planner simulations
+        YAML::Node localPlannerParameters = YAML::Clone(plannerParameters);
+        localPlannerParameters["Simulator"] = localSimulatorParameters;
+        AtomicAgent *globalPlannerPtr = new POMCPAtomicAgent<Domain::SingleAgentGlobalSimulatorState, Domain::SingleAgentGlobalSimulator>(
+          agentID,
+          numberOfActions,
+          horizon,
+          discountFactor,
+          plannerParameters,
+          new Domain::SingleAgentGlobalSimulator(agentID, domainPtr, agentComponent)
+        );
+        AtomicAgent *localPlannerPtr = makeRecurrentInfluenceAugmentedPOMCPAtomicAgent(agentID, numberOfActions, horizon, discountFactor, localPlannerParameters, domainPtr);
+        double globalSimulationsPerSecond = measureSimulationsPerSecond(globalPlannerPtr, agentID);
+        double localSimulationsPerSecond = measureSimulationsPerSecond(localPlannerPtr, agentID);
+
+        YAML::Node instanceYAML;
+        instanceYAML["numberOfAgents"] = domainPtr->getNumberOfAgents();
+        instanceYAML["numberOfVariables"] = domainPtr->getDBNPtr()->getNumberOfVariables();
+        instanceYAML["nativeModel"] = domainPtr->usesNativeModel();
+        instanceYAML["constructionSeconds"] = constructionTime;
+        instanceYAML["globalStepsPerSecond"] = globalStepsPerSecond;
+        instanceYAML["localStepsPerSecond"] = localStepsPerSecond;
+        instanceYAML["globalSimulationsPerSecond"] = globalSimulationsPerSecond;
+        instanceYAML["localSimulationsPerSecond"] = localSimulationsPerSecond;
+        instanceYAML["residentMemoryMB"] = readMemoryOfProcess("VmRSS") / 1024.0;
+        instanceYAML["peakResidentMemoryMB"] = readMemoryOfProcess("VmHWM") / 1024.0;
+        LOG(INFO) << "[Scaling] " << numberOfAgents << " agents: " << globalStepsPerSecond << " global and " << localStepsPerSecond << " local steps per second, "
+                  << globalSimulationsPerSecond << " global and " << localSimulationsPerSecond << " local simulations per second, "
+                  << instanceYAML["residentMemoryMB"].as<double>() << " MB resident.";
+        resultsYAML[std::to_string(numberOfAgents)] = instanceYAML;
+
+        delete globalPlannerPtr;
+        delete localPlannerPtr;
+        delete domainPtr;
+
+        // the results so far are kept if a larger instance does not fit
+        std::ofstream resultsYAMLFile;
+        resultsYAMLFile.open(pathToResultsFolder+"/results.yaml");
+        resultsYAMLFile << resultsYAML;
+        resultsYAMLFile.close();
+      }
+
+      return true;
+    }
+
+  private:
+    static YAML::Node generateNetwork(const std::string &domainName, const YAML::Node &domainParameters) {
+      if (domainName == "GridTraffic") {
+        return GridTrafficDomain::generateNetwork(domainParameters);
+      } else if (domainName == "GrabAChair") {
+        return GrabAChairDomain::generateNetwork(domainParameters);
+      } else if (domainName == "FireFighter") {
+        return FireFighterDomain::generateNetwork(domainParameters);
+      } else {
+        std::string message = "domain " + domainName + " is not supported.";
+        throw std::invalid_argument(message);
+      }
+    }
+
+    // steps with uniformly random actions from a new initial state every horizon steps, only the steps are timed
+    template <class Simulator>
+    static double measureStepsPerSecond(Simulator &simulator, int numberOfActions, int horizon, int numberOfSteps) {
+      Domain::SimulationContext context;
+      int observation;
+      float reward;
+      bool done;
+      double elapsedTime = 0.0;
+      for (int step=0; step<=numberOfSteps-1; step+=horizon) {
+        simulator.prepareContext(context);
+        auto state = simulator.sampleInitialState(context);
+        auto begin = std::chrono::steady_clock::now();
+        for (int t=0; t<=std::min(horizon, numberOfSteps-step)-1; t++) {
+          int action = std::uniform_int_distribution<int>(0, numberOfActions-1)(context.randomNumberGenerator);
+          simulator.step(state, action, observation, reward, done, context);
+        }
+        elapsedTime += std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+      }
+      return numberOfSteps / elapsedTime;
+    }
+
+    // one planning step from the initial belief
+    static double measureSimulationsPerSecond(AtomicAgent *plannerPtr, const std::string &agentID) {
+      EpisodeMetrics metrics({agentID}, 1);
+      YAML::Node agentsYAMLNode;
+      agentsYAMLNode["save"] = false;
+      plannerPtr->reset();
+      auto begin = std::chrono::steady_clock::now();
+      plannerPtr->act(metrics.getAgentMetrics(0), agentsYAMLNode);
+      double elapsedTime = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+      return metrics.get(NUMBER_OF_SIMULATIONS_PER_STEP, 0).back() / elapsedTime;
+    }
+
+    // a field of /proc/self/status in kB, 0 where it is not available
+    static double readMemoryOfProcess(const std::string &field) {
+      std::ifstream status("/proc/self/status");
+      std::string line;
+      while (std::getline(status, line)) {
+        if (line.rfind(field + ":", 0) == 0) {
+          return std::stod(line.substr(field.size() + 1));
+        }
+      }
+      return 0.0;
+    }
+
+};
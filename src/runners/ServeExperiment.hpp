@@ -0,0 +1,203 @@
+// a server that runs planning experiments submitted over a unix domain socket, one after another
+// the domains and the agents of recent configurations are kept in memory, so a configuration that is run again starts without loading
+// the DBN and the influence predictors. a configuration is only reused while it and every file it names are unchanged
+//
+// Experiment:
+//   socket: /tmp/fadmen.sock      # serve.sock in the results folder by default, only the user of the server can connect
+//   cacheSize: 4                  # the number of configurations kept in memory
+//   requestTimeout: 5.0           # seconds a client has to send its request, a client that stalls is dropped
+// a request is a line of JSON, {"config": "configs/GAC/5agent/global.yaml", "results": "results/GAC/5agent/global"} or {"command": "stop"},
+// answered by a line of JSON with "status" ok or error. paths are relative to the working directory of the server, see scripts/submit.py
+
+#include "Experiment.hpp"
+#include <list>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <chrono>
+#include <json.hpp>
+
+class ServeExperiment: public Experiment {
+
+  public:
+
+    ServeExperiment(std::string pathToConfigurationFile, std::string pathToResultsFolder):Experiment(pathToConfigurationFile, pathToResultsFolder){};
+
+    bool run(){
+
+      // read configurations
+      std::string pathToSocket = parameters["Experiment"]["socket"].IsDefined() ? parameters["Experiment"]["socket"].as<std::string>() : pathToResultsFolder + "/serve.sock";
+      _cacheSize = parameters["Experiment"]["cacheSize"].IsDefined() ? parameters["Experiment"]["cacheSize"].as<int>() : 4;
+      _requestTimeout = parameters["Experiment"]["requestTimeout"].IsDefined() ? parameters["Experiment"]["requestTimeout"].as<double>() : 5.0;
+
+      sockaddr_un address = {};
+      address.sun_family = AF_UNIX;
+      if (pathToSocket.size() >= sizeof(address.sun_path)) {
+        throw std::invalid_argument("the path of the socket " + pathToSocket + " is too long.");
+      }
+      strncpy(address.sun_path, pathToSocket.c_str(), sizeof(address.sun_path)-1);
+      int serverSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+      unlink(pathToSocket.c_str());
+      if (serverSocket < 0 || bind(serverSocket, (sockaddr*)&address, sizeof(address)) != 0 || chmod(pathToSocket.c_str(), 0600) != 0 || listen(serverSocket, 16) != 0) {
+        throw std::runtime_error("cannot listen on " + pathToSocket + ".");
+      }
+      // a client that leaves before its answer does not stop the server
+      signal(SIGPIPE, SIG_IGN);
+      LOG(INFO) << "[Serve] listening on " << pathToSocket << ".";
+
+      bool serving = true;
+      while (serving == true) {
+        int clientSocket = accept(serverSocket, nullptr, nullptr);
+        if (clientSocket < 0) {
+          continue;
+        }
+        std::string request;
+        if (readRequest(clientSocket, request) == false) {
+          LOG(WARNING) << "[Serve] a client has not sent its request within " << _requestTimeout << " seconds and is dropped.";
+          close(clientSocket);
+          continue;
+        }
+        nlohmann::json answer;
+        try {
+          nlohmann::json job = nlohmann::json::parse(request);
+          if (job.value("command", "") == "stop") {
+            serving = false;
+            answer["status"] = "ok";
+          } else {
+            answer = runJob(job.at("config").get<std::string>(), job.at("results").get<std::string>());
+          }
+        } catch (const std::exception &e) {
+          LOG(ERROR) << "[Serve] " << e.what();
+          answer["status"] = "error";
+          answer["message"] = e.what();
+        }
+        std::string answerLine = answer.dump() + "\n";
+        if (write(clientSocket, answerLine.data(), answerLine.size()) < 0) {
+          LOG(WARNING) << "[Serve] the client has left before its answer.";
+        }
+        close(clientSocket);
+      }
+
+      close(serverSocket);
+      unlink(pathToSocket.c_str());
+      LOG(INFO) << "[Serve] stopped.";
+      return true;
+    }
+
+  private:
+    int _cacheSize;
+    double _requestTimeout;
+    static constexpr size_t _maximumSizeOfRequest = 1 << 20;
+    // the resources of recently run configurations, the most recent first
+    std::list<std::pair<std::string, std::shared_ptr<PlanningResources>>> _cache;
+
+    // the first line a client sends, or everything it sends before it closes its end
+    // false if the client does not send it before the timeout, so that a client that stalls does not hold up the others
+    bool readRequest(int clientSocket, std::string &request) {
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(_requestTimeout);
+      char buffer[4096];
+      while (request.find('\n') == std::string::npos) {
+        long remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0 || request.size() > _maximumSizeOfRequest) {
+          return false;
+        }
+        pollfd fileDescriptor = {clientSocket, POLLIN, 0};
+        int numberOfReadyFileDescriptors = poll(&fileDescriptor, 1, (int)remaining);
+        if (numberOfReadyFileDescriptors < 0 && errno == EINTR) {
+          continue;
+        } else if (numberOfReadyFileDescriptors <= 0) {
+          return false;
+        }
+        ssize_t count = read(clientSocket, buffer, sizeof(buffer));
+        if (count <= 0) {
+          break;
+        }
+        request.append(buffer, count);
+      }
+      request = request.substr(0, request.find('\n'));
+      return true;
+    }
+
+    nlohmann::json runJob(const std::string &pathToConfigurationFile, const std::string &pathToResultsFolderOfJob) {
+      auto begin = std::chrono::steady_clock::now();
+      YAML::Node configuration = YAML::LoadFile(pathToConfigurationFile);
+      std::string key = getKey(pathToConfigurationFile, configuration);
+
+      std::shared_ptr<PlanningResources> resources;
+      for (auto it = _cache.begin(); it != _cache.end(); it++) {
+        if (it->first == key) {
+          resources = it->second;
+          _cache.erase(it);
+          break;
+        }
+      }
+
+      // the job logs to its own results folder, as a run of its own would
+      std::filesystem::create_directories(pathToResultsFolderOfJob + "/logs/");
+      std::filesystem::create_directories(pathToResultsFolderOfJob + "/replays/");
+      google::SetLogDestination(google::GLOG_INFO, (pathToResultsFolderOfJob + "/logs/").c_str());
+      LOG(INFO) << "[Serve] running " << pathToConfigurationFile << " into " << pathToResultsFolderOfJob << (resources != nullptr ? " with its domain and agents in memory." : ".");
+      LOG(INFO) << "\n-------------Experimental Parameters:-------------\n" << configuration << "\n--------------------------------------------------\n";
+      bool cached = resources != nullptr;
+      try {
+        PlanningExperiment experiment(configuration, pathToResultsFolderOfJob);
+        experiment.setResources(resources);
+        experiment.run();
+        resources = experiment.getResources();
+      } catch (...) {
+        google::SetLogDestination(google::GLOG_INFO, (pathToResultsFolder + "/logs/").c_str());
+        throw;
+      }
+      google::SetLogDestination(google::GLOG_INFO, (pathToResultsFolder + "/logs/").c_str());
+
+      _cache.push_front({key, resources});
+      while ((int)_cache.size() > _cacheSize) {
+        VLOG(1) << "[Serve] " << _cache.back().first << " is dropped from memory.";
+        _cache.pop_back();
+      }
+
+      nlohmann::json answer;
+      answer["status"] = "ok";
+      answer["cached"] = cached;
+      answer["seconds"] = std::chrono::duration<double>(std::chrono::steady_clock::now()-begin).count();
+      LOG(INFO) << "[Serve] " << pathToConfigurationFile << " has finished after " << answer["seconds"].get<double>() << " seconds.";
+      return answer;
+    }
+
+    // the configuration file and every file it names, with the times they were last modified
+    // a directory it names, such as the data of an influence predictor, is named by every file in it
+    static std::string getKey(const std::string &pathToConfigurationFile, const YAML::Node &configuration) {
+      std::string key = FileUtils::versionedPath(pathToConfigurationFile);
+      std::function<void(const YAML::Node &)> addFiles = [&](const YAML::Node &node) {
+        if (node.IsScalar() && std::filesystem::is_regular_file(node.Scalar())) {
+          key += "|" + FileUtils::versionedPath(node.Scalar());
+        } else if (node.IsScalar() && std::filesystem::is_directory(node.Scalar())) {
+          std::vector<std::string> paths;
+          for (auto &entry: std::filesystem::recursive_directory_iterator(node.Scalar())) {
+            if (entry.is_regular_file() == true) {
+              paths.push_back(entry.path().string());
+            }
+          }
+          std::sort(paths.begin(), paths.end());
+          key += "|" + node.Scalar() + "/";
+          for (auto &path: paths) {
+            key += "|" + FileUtils::versionedPath(path);
+          }
+        } else if (node.IsMap()) {
+          for (auto it = node.begin(); it != node.end(); it++) {
+            addFiles(it->second);
+          }
+        } else if (node.IsSequence()) {
+          for (auto it = node.begin(); it != node.end(); it++) {
+            addFiles(*it);
+          }
+        }
+      };
+      addFiles(configuration);
+      return key;
+    }
+
+};
@@ -0,0 +1,131 @@
+// planning experiments of many configurations in one process
+// the episodes of all configurations are run by one pool of workers, the episodes of costly configurations first, so that the cheap ones
+// fill in the gaps at the end instead of a costly configuration running alone. every DBN file is loaded once, and the influence predictors
+// of configurations with the same model share it through the registry of shared resources
+//
+// Experiment:
+//   configs: [configs/GAC/5agent/*.yaml, configs/GAC-coupling/p01/global.yaml]    # paths or glob patterns
+//   numberOfWorkers: 8
+// the results of every configuration are written to the results folder under the path of the configuration without "configs/"
+// and its extension, as scripts/run_benchmark does, e.g. results/GAC/5agent/global for configs/GAC/5agent/global.yaml
+// a sharded sweep runs the shard of every configuration, which are merged per configuration
+// the episodes are run by threads, configurations with workerType: Process are refused
+
+#include "Experiment.hpp"
+#include <glob.h>
+#include <filesystem>
+#include <algorithm>
+
+class SweepExperiment: public Experiment {
+
+  public:
+
+    SweepExperiment(std::string pathToConfigurationFile, std::string pathToResultsFolder, Shard shard = Shard()):Experiment(pathToConfigurationFile, pathToResultsFolder), shard(shard){};
+
+    bool run(){
+
+      // read configurations
+      std::vector<std::string> patterns = parameters["Experiment"]["configs"].as<std::vector<std::string>>();
+      int numberOfWorkers = parameters["Experiment"]["numberOfWorkers"].IsDefined() ? parameters["Experiment"]["numberOfWorkers"].as<int>() : 1;
+      numberOfWorkers = std::max(1, numberOfWorkers);
+      if (parameters["Experiment"]["workerType"].IsDefined() && parameters["Experiment"]["workerType"].as<std::string>() != "Thread") {
+        throw std::invalid_argument("a sweep runs its episodes in threads, worker type " + parameters["Experiment"]["workerType"].as<std::string>() + " is not supported.");
+      }
+      std::vector<std::string> pathsToConfigurationFiles = expandPatterns(patterns);
+      LOG(INFO) << "[Sweep] " << pathsToConfigurationFiles.size() << " configurations are run by " << numberOfWorkers << " workers.";
+
+      // the networks of the configurations, by the path of their file
+      std::map<std::string, YAML::Node> networks;
+      std::vector<std::unique_ptr<PlanningExperiment>> experiments;
+      std::set<std::string> resultsFolders;
+      for (auto &pathToConfigurationFile: pathsToConfigurationFiles) {
+        std::string resultsFolder = pathToResultsFolder + "/" + getNameOfConfiguration(pathToConfigurationFile);
+        if (resultsFolders.insert(resultsFolder).second == false) {
+          throw std::invalid_argument("configurations " + pathToConfigurationFile + " and another one share the results folder " + resultsFolder + ".");
+        }
+
+        YAML::Node configuration = YAML::LoadFile(pathToConfigurationFile);
+        if (configuration["Experiment"]["workerType"].IsDefined() && configuration["Experiment"]["workerType"].as<std::string>() != "Thread") {
+          throw std::invalid_argument("configuration " + pathToConfigurationFile + " asks for worker type " + configuration["Experiment"]["workerType"].as<std::string>() + ", but a sweep runs its episodes in threads.");
+        }
+        LOG(INFO) << "\n-------------Experimental Parameters of " << pathToConfigurationFile << ":-------------\n" << configuration << "\n--------------------------------------------------\n";
+        std::string domainName = configuration["General"]["domain"].as<std::string>();
+        YAML::Node domainParameters = configuration[domainName];
+        if (domainParameters["network"].IsDefined() == false && domainParameters["generate"].IsDefined() == false) {
+          std::string yamlFilePath = domainParameters["2SDBNYamlFilePath"].as<std::string>();
+          if (networks.find(yamlFilePath) == networks.end()) {
+            networks[yamlFilePath] = TwoStageDynamicBayesianNetwork::loadNetwork(yamlFilePath);
+          }
+          domainParameters["network"] = networks.at(yamlFilePath);
+        }
+
+        experiments.emplace_back(new PlanningExperiment(configuration, resultsFolder, shard));
+        experiments.back()->prepare(numberOfWorkers);
+      }
+      LOG(INFO) << "[Sweep] " << networks.size() << " distinct DBN files have been loaded.";
+
+      // an episode is a task, the tasks of costly configurations are run first
+      std::vector<std::pair<double, int>> costs;
+      for (int c=0; c<=(int)experiments.size()-1; c++) {
+        costs.push_back({experiments[c]->estimateSecondsPerEpisode(), c});
+      }
+      std::stable_sort(costs.begin(), costs.end(), [](const std::pair<double, int> &a, const std::pair<double, int> &b) {
+        return a.first > b.first;
+      });
+      std::vector<std::pair<int, int>> tasks;
+      for (auto &[cost, c]: costs) {
+        VLOG(1) << "[Sweep] " << pathsToConfigurationFiles[c] << ": about " << cost << " seconds per episode.";
+        for (int i=0; i<=experiments[c]->getNumberOfEpisodes()-1; i++) {
+          tasks.push_back({c, i});
+        }
+      }
+
+      // idle workers take the next task
+      ProcessPool::markThreadsStarted();
+      #pragma omp parallel for schedule(dynamic, 1) num_threads(numberOfWorkers)
+      for (int t=0; t<=(int)tasks.size()-1; t++) {
+        experiments[tasks[t].first]->runEpisode(tasks[t].second);
+      }
+
+      for (int c=0; c<=(int)experiments.size()-1; c++) {
+        experiments[c]->finish();
+        LOG(INFO) << "[Sweep] results of " << pathsToConfigurationFiles[c] << " have been written.";
+      }
+
+      return true;
+    }
+
+  private:
+    Shard shard;
+
+    // the files matching the patterns, in the order of the patterns and without duplicates
+    static std::vector<std::string> expandPatterns(const std::vector<std::string> &patterns) {
+      std::vector<std::string> paths;
+      std::set<std::string> seen;
+      for (auto &pattern: patterns) {
+        glob_t matches;
+        if (glob(pattern.c_str(), 0, nullptr, &matches) != 0) {
+          globfree(&matches);
+          throw std::invalid_argument("no configuration matches " + pattern + ".");
+        }
+        for (size_t i=0; i<=matches.gl_pathc-1; i++) {
+          std::string path = matches.gl_pathv[i];
+          if (seen.insert(path).second == true) {
+            paths.push_back(path);
+          }
+        }
+        globfree(&matches);
+      }
+      return paths;
+    }
+
+    // the path of a configuration without its extension and without a leading "configs/"
+    static std::string getNameOfConfiguration(const std::string &pathToConfigurationFile) {
+      std::filesystem::path path = std::filesystem::path(pathToConfigurationFile).relative_path().replace_extension();
+      if (path.begin() != path.end() && *path.begin() == "configs") {
+        path = path.lexically_relative("configs");
+      }
+      return path.string();
+    }
+
+};
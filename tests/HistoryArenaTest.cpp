@@ -0,0 +1,131 @@
+// the global simulator with other agents that only support the AOH, whose histories are kept in the history arena of the context
+// none of the agents of the domains is such an agent, they all have a compact policy state, so the agents here hide theirs
+// run from the root of the repository, as ctest does
+
+#include <iostream>
+#include "domains/GrabAChair/GrabAChairDomain.hpp"
+#include "agents/PlanningAgent.hpp"
+
+#define EXPECT(condition) if (!(condition)) { std::cerr << __FILE__ << ":" << __LINE__ << ": " << #condition << " does not hold." << std::endl; return 1; }
+
+// an agent simulator without a compact policy state
+class AOHOnlyAtomicAgentSimulator: public AtomicAgentSimulator {
+  public:
+    AOHOnlyAtomicAgentSimulator(AtomicAgentSimulator *simulatorPtr): _simulatorPtr(simulatorPtr) {}
+    int step(const std::vector<int>::iterator &it) {
+      return _simulatorPtr->step(it);
+    }
+  private:
+    std::unique_ptr<AtomicAgentSimulator> _simulatorPtr;
+};
+
+class AOHOnlyGrabAChairDomain: public GrabAChairDomain {
+  public:
+    AOHOnlyGrabAChairDomain(const YAML::Node &parameters): GrabAChairDomain(parameters) {}
+    AtomicAgentSimulator *makeAtomicAgentSimulator(const std::string &agentID, const std::string &agentType) {
+      return new AOHOnlyAtomicAgentSimulator(GrabAChairDomain::makeAtomicAgentSimulator(agentID, agentType));
+    }
+};
+
+typedef POMCPAtomicAgent<Domain::SingleAgentGlobalSimulatorState, Domain::SingleAgentGlobalSimulator> GlobalPOMCPAtomicAgent;
+
+const char *configuration = R"(
+General: {domain: GrabAChair, horizon: 10, discountFactor: 1.0, IDOfAgentToControl: '1'}
+GrabAChair: {2SDBNYamlFilePath: configs/2SDBNYamlFiles/GAC/5AgentsGrabAChairP00.yaml}
+AgentComponent:
+  '1':
+    Type: POMCP
+    Simulator: {Type: Global}
+    Rollout: {numberOfSimulationsPerStep: 300, numberOfParticles: 300, discountHorizon: 0.0, explorationConstant: 100.0, particleReinvigoration: true, particleReinvigorationRate: 0.1}
+  '2': {Type: Count}
+  '3': {Type: Count}
+  '4': {Type: Count}
+  '5': {Type: Count}
+)";
+
+int testArena() {
+  Domain::HistoryArena arena;
+  int a = arena.append(-1, 1);
+  int ab = arena.append(a, 0);
+  EXPECT(arena.append(-1, 1) == a);
+  EXPECT(arena.append(a, 0) == ab);
+  int ac = arena.append(a, 1);
+  EXPECT(ac != ab);
+  int d = arena.append(-1, 0);
+  EXPECT(arena.nodes.size() == 4);
+
+  // keep the histories ending in ac and d, their renumbered nodes are found again by append
+  int history1 = ac, history2 = d;
+  std::vector<int> renumbering = arena.retain({&history1, &history2});
+  EXPECT(arena.nodes.size() == 3);
+  EXPECT(renumbering[ab] == -1);
+  EXPECT(arena.append(-1, 1) == renumbering[a]);
+  EXPECT(arena.append(renumbering[a], 1) == history1);
+  EXPECT(arena.append(-1, 0) == history2);
+  std::vector<int> AOH(5);
+  arena.materialize(history1, AOH);
+  EXPECT(AOH[0] == 3 && AOH[1] == 1 && AOH[2] == 1);
+  return 0;
+}
+
+// the actions of a planner whose other agents are simulated through their AOHs or their compact states
+int plan(Domain *domainPtr, bool AOHOnly, std::vector<int> &actions, std::vector<int> &visits, size_t &maximumNumberOfNodes) {
+  std::experimental::reseed(1);
+  GlobalPOMCPAtomicAgent *agentPtr = dynamic_cast<GlobalPOMCPAtomicAgent*>(domainPtr->makeAtomicAgent("1", "POMCP"));
+  EXPECT(agentPtr != nullptr);
+  agentPtr->seed(2);
+  agentPtr->reset();
+  EpisodeMetrics metrics({"1"}, 10);
+  YAML::Node agentsYAMLNode;
+  agentsYAMLNode["save"] = false;
+  maximumNumberOfNodes = 0;
+  for (int step=0; step<=9; step++) {
+    actions.push_back(agentPtr->act(metrics.getAgentMetrics(0), agentsYAMLNode));
+    for (auto &[action, actionNodePtr]: agentPtr->_rootObservationNodePtr->getChildrenNodes()) {
+      visits.push_back(actionNodePtr->getN());
+    }
+    Domain::HistoryArena &arena = agentPtr->_simulationContext.histories;
+    maximumNumberOfNodes = std::max(maximumNumberOfNodes, arena.nodes.size());
+    int observation = step % 3 == 0 ? 0 : 1;
+    agentPtr->observe(observation);
+
+    // after the tree has been pruned the arena keeps at most the nodes of the histories of the particles left
+    if (AOHOnly == false) {
+      continue;
+    }
+    std::vector<Domain::SingleAgentGlobalSimulatorState*> states;
+    agentPtr->_rootObservationNodePtr->collectParticles(states);
+    size_t lengthOfHistories = 0;
+    for (auto statePtr: states) {
+      for (auto &history: statePtr->AOH) {
+        EXPECT(history >= -1 && history < (int)arena.nodes.size());
+        lengthOfHistories += history == -1 ? 0 : arena.nodes[history].length;
+      }
+    }
+    EXPECT(arena.nodes.size() <= lengthOfHistories);
+  }
+  delete agentPtr;
+  return 0;
+}
+
+int main() {
+  if (testArena() != 0) {
+    return 1;
+  }
+
+  YAML::Node parameters = YAML::Load(configuration);
+  GrabAChairDomain domain(parameters);
+  AOHOnlyGrabAChairDomain AOHOnlyDomain(parameters);
+  std::vector<int> actions, AOHOnlyActions, visits, AOHOnlyVisits;
+  size_t numberOfNodes, AOHOnlyNumberOfNodes;
+  if (plan(&domain, false, actions, visits, numberOfNodes) != 0 || plan(&AOHOnlyDomain, true, AOHOnlyActions, AOHOnlyVisits, AOHOnlyNumberOfNodes) != 0) {
+    return 1;
+  }
+  // the compact states summarize the AOHs, so both simulate the same and the planners search the same trees
+  EXPECT(numberOfNodes == 0);
+  EXPECT(AOHOnlyNumberOfNodes > 0);
+  EXPECT(actions == AOHOnlyActions);
+  EXPECT(visits == AOHOnlyVisits);
+  std::cout << "history arena: at most " << AOHOnlyNumberOfNodes << " nodes while planning." << std::endl;
+  return 0;
+}
@@ -0,0 +1,46 @@
+# a smoke test of the python module maps, built with -DBUILD_PYTHON_BINDINGS=ON
+# run from the root of the repository with the directory of the module on PYTHONPATH, as ctest does
+
+import sys
+import numpy as np
+import maps
+
+def check(condition, message):
+  if not condition:
+    print(message, file=sys.stderr)
+    sys.exit(1)
+
+domain = maps.Domain("configs/GAC/5agent/global.yaml")
+simulator = maps.GlobalSimulator(domain, "1")
+number_of_actions = domain.number_of_actions("1")
+
+# rollout fills the arrays in place, and the same seed gives the same episodes
+actions = np.full((8, 10), -1, dtype=np.int32)
+observations = np.full((8, 10), -1, dtype=np.int32)
+rewards = np.zeros((8, 10), dtype=np.float32)
+simulator.rollout(actions, observations, rewards, seed=0)
+check(((actions >= 0) & (actions < number_of_actions)).all(), "rollout: actions out of range")
+check((observations >= 0).all(), "rollout: observations not written")
+same_actions = np.zeros_like(actions)
+simulator.rollout(same_actions, np.zeros_like(observations), np.zeros_like(rewards), seed=0)
+check((actions == same_actions).all(), "rollout: not reproducible with a seed")
+
+# influence_data fills the training data of the influence predictor, the last input of a step is the action
+inputs = np.full((8, 9, len(simulator.inputs)), -1, dtype=np.int32)
+outputs = np.full((8, 9, len(simulator.outputs)), -1, dtype=np.int32)
+simulator.influence_data(inputs, outputs, seed=0)
+check((inputs >= 0).all() and (outputs >= 0).all(), "influence_data: arrays not filled")
+check((inputs[:, :, -1] < number_of_actions).all(), "influence_data: actions out of range")
+
+# arrays of the wrong shape or type are refused instead of written out of bounds
+for inputs, outputs in [
+  (np.zeros((8, 0, len(simulator.inputs)), dtype=np.int32), np.zeros((8, 0, len(simulator.outputs)), dtype=np.int32)),
+  (np.zeros((8, 9, len(simulator.inputs)), dtype=np.int32), np.zeros((8, 8, len(simulator.outputs)), dtype=np.int32)),
+  (np.zeros((8, 9, len(simulator.inputs)), dtype=np.int64), np.zeros((8, 9, len(simulator.outputs)), dtype=np.int32))]:
+  try:
+    simulator.influence_data(inputs, outputs)
+    check(False, "influence_data: accepted inputs of shape {} and outputs of shape {}".format(inputs.shape, outputs.shape))
+  except ValueError:
+    pass
+
+print("python bindings: ok")